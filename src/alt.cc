@@ -0,0 +1,442 @@
+// Copyright (c) 2015, The Regents of the University of California (Regents)
+// See LICENSE.txt for license details
+
+#include <algorithm>
+#include <cinttypes>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <queue>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "benchmark.h"
+#include "bin_pool.h"
+#include "builder.h"
+#include "command_line.h"
+#include "graph.h"
+#include "pvector.h"
+#include "shortest_path.h"
+#include "timer.h"
+
+
+/*
+GAP Benchmark Suite
+Kernel: Landmark (ALT) Point-to-Point Shortest Paths
+
+Returns distances for a batch of random source-target pairs
+
+Builds an index of the distances from and to a few landmark vertices, and then
+answers point-to-point queries with A* search guided by the lower bounds the
+triangle inequality gives from those distances (ALT [1]). For landmark L and
+query target t, d(v,t) >= d(L,t) - d(L,v) and d(v,t) >= d(v,L) - d(t,L). Taking
+the largest of these bounds over the landmarks never overestimates, so the
+target's distance is exact once it is settled, and a query only settles the
+vertices that could be on a shortest path instead of everything closer than
+the target. If some landmark reaches v but not t, t can't be reached from v
+either, so those vertices are pruned. Terms for landmarks that can't reach v
+or t are skipped, so which landmarks bound a vertex varies and the heuristic
+need not be consistent. A vertex can then be reached by a shorter path after
+it was settled, so it is reopened (queued again), and may be settled more
+than once.
+
+The index is built by running the parallel SSSP from sssp (DeltaStep, or
+MultiQueueSSSP with -m) from each landmark, and for directed graphs also on
+the transposed graph. Landmarks are picked greedily to be far apart [1]: the
+first is random, and each next one is the vertex that is farthest from its
+closest landmark chosen so far. The tables are vertex-major, so the bounds for
+a vertex are contiguous. The index can be saved (-o) and loaded (-i), so it
+only needs to be built once per graph.
+
+Queries within a batch run in parallel. Each thread keeps its own distance
+array across queries and batches (QueryStatePool), allocated the first time
+it runs a query, and only resets the entries a query touched, so a query's
+cost depends on the part of the graph it visits rather than the size of the
+graph.
+
+[1] Andrew V. Goldberg and Chris Harrelson. "Computing the shortest path: A*
+    search meets graph theory." Symposium on Discrete Algorithms (SODA),
+    pages 156-165, 2005.
+*/
+
+
+using namespace std;
+
+struct LandmarkIndex {
+  bool directed;
+  int64_t num_nodes;
+  int64_t num_edges;  // only to check index matches graph it is used with
+  int64_t num_landmarks;
+  vector<NodeID> landmarks;
+  vector<WeightT> from_landmark;  // [v*num_landmarks + i] = d(L_i, v)
+  vector<WeightT> to_landmark;    // [v*num_landmarks + i] = d(v, L_i)
+
+  // Lower bound on d(v, t), kDistInf if t is provably unreachable from v
+  WeightT LowerBound(NodeID v, NodeID t) const {
+    const WeightT *from_v = &from_landmark[v * num_landmarks];
+    const WeightT *from_t = &from_landmark[t * num_landmarks];
+    const WeightT *to_v = &(directed ? to_landmark : from_landmark)[
+                               v * num_landmarks];
+    const WeightT *to_t = &(directed ? to_landmark : from_landmark)[
+                               t * num_landmarks];
+    WeightT bound = 0;
+    for (int64_t i=0; i < num_landmarks; i++) {
+      if ((from_v[i] != kDistInf) && (from_t[i] == kDistInf))
+        return kDistInf;
+      if ((from_v[i] != kDistInf) && (from_t[i] - from_v[i] > bound))
+        bound = from_t[i] - from_v[i];
+      if ((to_v[i] != kDistInf) && (to_t[i] != kDistInf) &&
+          (to_v[i] - to_t[i] > bound))
+        bound = to_v[i] - to_t[i];
+    }
+    return bound;
+  }
+};
+
+
+// Writes index as raw binary, laid out like the fields of LandmarkIndex
+void SaveIndex(const LandmarkIndex &index, string filename) {
+  fstream out(filename, ios::out | ios::binary);
+  if (!out) {
+    cout << "Couldn't write to file " << filename << endl;
+    exit(-5);
+  }
+  out.write(reinterpret_cast<const char*>(&index.directed), sizeof(bool));
+  out.write(reinterpret_cast<const char*>(&index.num_nodes), sizeof(int64_t));
+  out.write(reinterpret_cast<const char*>(&index.num_edges), sizeof(int64_t));
+  out.write(reinterpret_cast<const char*>(&index.num_landmarks),
+            sizeof(int64_t));
+  out.write(reinterpret_cast<const char*>(index.landmarks.data()),
+            index.num_landmarks * sizeof(NodeID));
+  streamsize table_bytes = index.num_nodes * index.num_landmarks *
+                           sizeof(WeightT);
+  out.write(reinterpret_cast<const char*>(index.from_landmark.data()),
+            table_bytes);
+  if (index.directed)
+    out.write(reinterpret_cast<const char*>(index.to_landmark.data()),
+              table_bytes);
+}
+
+
+LandmarkIndex LoadIndex(const WGraph &g, string filename) {
+  Timer t;
+  t.Start();
+  fstream in(filename, ios::in | ios::binary);
+  if (!in) {
+    cout << "Couldn't open file " << filename << endl;
+    exit(-2);
+  }
+  LandmarkIndex index;
+  in.read(reinterpret_cast<char*>(&index.directed), sizeof(bool));
+  in.read(reinterpret_cast<char*>(&index.num_nodes), sizeof(int64_t));
+  in.read(reinterpret_cast<char*>(&index.num_edges), sizeof(int64_t));
+  in.read(reinterpret_cast<char*>(&index.num_landmarks), sizeof(int64_t));
+  if (!in || (index.num_nodes != g.num_nodes()) ||
+      (index.num_edges != g.num_edges()) || (index.directed != g.directed())) {
+    cout << "Index in " << filename << " does not match graph" << endl;
+    exit(-20);
+  }
+  index.landmarks.resize(index.num_landmarks);
+  in.read(reinterpret_cast<char*>(index.landmarks.data()),
+          index.num_landmarks * sizeof(NodeID));
+  index.from_landmark.resize(index.num_nodes * index.num_landmarks);
+  streamsize table_bytes = index.num_nodes * index.num_landmarks *
+                           sizeof(WeightT);
+  in.read(reinterpret_cast<char*>(index.from_landmark.data()), table_bytes);
+  if (index.directed) {
+    index.to_landmark.resize(index.num_nodes * index.num_landmarks);
+    in.read(reinterpret_cast<char*>(index.to_landmark.data()), table_bytes);
+  }
+  if (!in) {
+    cout << "Index in " << filename << " is truncated" << endl;
+    exit(-20);
+  }
+  t.Stop();
+  PrintTime("Index Load Time", t.Seconds());
+  return index;
+}
+
+
+void FillColumn(vector<WeightT> &table, int64_t column, int64_t num_columns,
+                const pvector<WeightT> &dist) {
+  #pragma omp parallel for
+  for (NodeID v=0; v < static_cast<NodeID>(dist.size()); v++)
+    table[v * num_columns + column] = dist[v];
+}
+
+
+// SSSP(graph, source) runs a full search, run on transposed graph (gt) for
+// the distances to the landmarks if directed
+template <typename SSSPFunc>
+LandmarkIndex BuildIndex(const WGraph &g, const WGraph &gt,
+                         int64_t num_landmarks, SSSPFunc SSSP) {
+  Timer t;
+  t.Start();
+  LandmarkIndex index;
+  index.directed = g.directed();
+  index.num_nodes = g.num_nodes();
+  index.num_edges = g.num_edges();
+  index.num_landmarks = 0;
+  index.from_landmark.resize(g.num_nodes() * num_landmarks);
+  if (index.directed)
+    index.to_landmark.resize(g.num_nodes() * num_landmarks);
+  // distance from each vertex to its closest landmark so far
+  pvector<WeightT> closest(g.num_nodes(), kDistInf);
+  SourcePicker<WGraph> sp(g);
+  NodeID next_landmark = sp.PickNext();
+  while (index.num_landmarks < num_landmarks) {
+    NodeID landmark = next_landmark;
+    index.landmarks.push_back(landmark);
+    pvector<WeightT> dist = SSSP(g, landmark);
+    FillColumn(index.from_landmark, index.num_landmarks, num_landmarks, dist);
+    if (index.directed) {
+      pvector<WeightT> dist_to = SSSP(gt, landmark);
+      FillColumn(index.to_landmark, index.num_landmarks, num_landmarks,
+                 dist_to);
+    }
+    index.num_landmarks++;
+    // Farthest reached vertex from all landmarks so far is the next one
+    WeightT farthest = 0;
+    #pragma omp parallel
+    {
+      WeightT local_farthest = 0;
+      NodeID local_next = -1;
+      #pragma omp for nowait
+      for (NodeID v=0; v < g.num_nodes(); v++) {
+        closest[v] = min(closest[v], dist[v]);
+        if ((closest[v] != kDistInf) && (closest[v] > local_farthest)) {
+          local_farthest = closest[v];
+          local_next = v;
+        }
+      }
+      #pragma omp critical
+      if ((local_farthest > farthest) ||
+          ((local_farthest == farthest) && (local_next > next_landmark))) {
+        farthest = local_farthest;
+        next_landmark = local_next;
+      }
+    }
+    if (farthest == 0)
+      break;
+  }
+  // columns for landmarks that weren't needed are dropped
+  if (index.num_landmarks < num_landmarks) {
+    vector<WeightT> *tables[2] = {&index.from_landmark, &index.to_landmark};
+    for (vector<WeightT> *table : tables) {
+      if (table->empty())
+        continue;
+      vector<WeightT> packed(g.num_nodes() * index.num_landmarks);
+      for (NodeID v=0; v < g.num_nodes(); v++) {
+        for (int64_t i=0; i < index.num_landmarks; i++)
+          packed[v * index.num_landmarks + i] = (*table)[v * num_landmarks + i];
+      }
+      table->swap(packed);
+    }
+  }
+  t.Stop();
+  PrintStep("Landmarks", index.num_landmarks);
+  PrintTime("Index Build Time", t.Seconds());
+  return index;
+}
+
+
+// Per-thread state for A* that is reused across queries
+struct QueryState {
+  pvector<WeightT> dist;
+  vector<NodeID> touched;
+};
+
+
+// Per-thread QueryStates kept across batches, each allocated on first use
+class QueryStatePool {
+  int64_t num_nodes_;
+  vector<QueryState> states_;
+
+ public:
+  explicit QueryStatePool(int64_t num_nodes)
+      : num_nodes_(num_nodes), states_(MaxThreads()) {}
+
+  // State of calling thread, must be called from a region with at most
+  // MaxThreads() threads as of the pool's construction
+  QueryState& local() {
+    QueryState &state = states_[ThreadNum()];
+    if (state.dist.empty())
+      pvector<WeightT>(num_nodes_, kDistInf).swap(state.dist);
+    return state;
+  }
+};
+
+
+WeightT AStarQuery(const WGraph &g, const LandmarkIndex &index, NodeID source,
+                   NodeID target, QueryState &state, int64_t &num_settled) {
+  // (estimate of total path length, distance from source, vertex)
+  typedef pair<WeightT, pair<WeightT, NodeID>> QueueEntry;
+  priority_queue<QueueEntry, vector<QueueEntry>, greater<QueueEntry>> frontier;
+  WeightT answer = kDistInf;
+  if (index.LowerBound(source, target) != kDistInf) {
+    state.dist[source] = 0;
+    state.touched.push_back(source);
+    frontier.push(make_pair(0, make_pair(0, source)));
+  }
+  while (!frontier.empty()) {
+    WeightT u_dist = frontier.top().second.first;
+    NodeID u = frontier.top().second.second;
+    frontier.pop();
+    if (u_dist != state.dist[u])
+      continue;
+    num_settled++;
+    if (u == target) {
+      answer = u_dist;
+      break;
+    }
+    for (WNode wn : g.out_neigh(u)) {
+      WeightT new_dist = u_dist + wn.w;
+      if (new_dist < state.dist[wn.v]) {
+        WeightT bound = index.LowerBound(wn.v, target);
+        if (bound == kDistInf)
+          continue;
+        if (state.dist[wn.v] == kDistInf)
+          state.touched.push_back(wn.v);
+        state.dist[wn.v] = new_dist;
+        frontier.push(make_pair(new_dist + bound, make_pair(new_dist, wn.v)));
+      }
+    }
+  }
+  for (NodeID v : state.touched)
+    state.dist[v] = kDistInf;
+  state.touched.clear();
+  return answer;
+}
+
+
+pvector<WeightT> RunQueries(const WGraph &g, const LandmarkIndex &index,
+                            const vector<pair<NodeID, NodeID>> &queries,
+                            QueryStatePool &state_pool) {
+  pvector<WeightT> answers(queries.size());
+  int64_t total_settled = 0;
+  #pragma omp parallel reduction(+ : total_settled)
+  {
+    QueryState &state = state_pool.local();
+    #pragma omp for schedule(dynamic, 1)
+    for (size_t q=0; q < queries.size(); q++) {
+      answers[q] = AStarQuery(g, index, queries[q].first, queries[q].second,
+                              state, total_settled);
+    }
+  }
+  if (!queries.empty()) {
+    PrintStep("Avg Settled", total_settled / static_cast<int64_t>(
+                                                 queries.size()));
+  }
+  return answers;
+}
+
+
+void PrintALTStats(const WGraph &g, const pvector<WeightT> &answers) {
+  auto NotInf = [](WeightT d) { return d != kDistInf; };
+  int64_t num_connected = count_if(answers.begin(), answers.end(), NotInf);
+  cout << num_connected << " of " << answers.size() << " queries connected"
+       << endl;
+}
+
+
+// Compares against serial Dijkstra from each query's source
+bool ALTVerifier(const WGraph &g, const vector<pair<NodeID, NodeID>> &queries,
+                 const pvector<WeightT> &answers) {
+  typedef pair<WeightT, NodeID> WN;
+  pvector<WeightT> oracle_dist(g.num_nodes());
+  bool all_ok = true;
+  for (size_t q=0; q < queries.size(); q++) {
+    NodeID source = queries[q].first;
+    NodeID target = queries[q].second;
+    oracle_dist.fill(kDistInf);
+    oracle_dist[source] = 0;
+    priority_queue<WN, vector<WN>, greater<WN>> mq;
+    mq.push(make_pair(0, source));
+    while (!mq.empty()) {
+      WeightT td = mq.top().first;
+      NodeID u = mq.top().second;
+      mq.pop();
+      if (u == target)
+        break;
+      if (td == oracle_dist[u]) {
+        for (WNode wn : g.out_neigh(u)) {
+          if (td + wn.w < oracle_dist[wn.v]) {
+            oracle_dist[wn.v] = td + wn.w;
+            mq.push(make_pair(td + wn.w, wn.v));
+          }
+        }
+      }
+    }
+    if (answers[q] != oracle_dist[target]) {
+      cout << source << " -> " << target << ": " << answers[q] << " != "
+           << oracle_dist[target] << endl;
+      all_ok = false;
+    }
+  }
+  return all_ok;
+}
+
+
+int main(int argc, char* argv[]) {
+  CLALT<WeightT> cli(argc, argv, "landmark point-to-point shortest-path");
+  if (!cli.ParseArgs())
+    return -1;
+  WeightedBuilder b(cli);
+  WGraph g = b.MakeGraph();
+  LandmarkIndex index;
+  if (cli.index_in() != "") {
+    index = LoadIndex(g, cli.index_in());
+  } else {
+    WeightedBuilder::SortByWeight(g);
+    WGraph gt = g.directed() ? WeightedBuilder::Transpose(g) : WGraph();
+    if (g.directed())
+      WeightedBuilder::SortByWeight(gt);
+    BinPool<NodeID> bin_pool;
+    WeightT delta = cli.delta();
+    if (cli.auto_delta()) {
+      delta = EstimateDelta(g);
+      if (cli.probe_delta())
+        delta = ProbeDelta(g, delta, bin_pool);
+      PrintStep("Delta", static_cast<int64_t>(delta));
+    }
+    bool use_multiqueue = cli.use_multiqueue();
+    pvector<NodeID> light_g, light_gt;
+    if (!use_multiqueue) {
+      light_g = CountLightEdges(g, delta);
+      if (g.directed())
+        light_gt = CountLightEdges(gt, delta);
+    }
+    auto SSSP = [&g, &light_g, &light_gt, delta, &bin_pool, use_multiqueue] (
+        const WGraph &search_g, NodeID source) {
+      if (use_multiqueue)
+        return MultiQueueSSSP(search_g, source, false);
+      const pvector<NodeID> &light_degree = &search_g == &g ? light_g :
+                                                              light_gt;
+      return DeltaStep(search_g, source, delta, light_degree, bin_pool,
+                       false);
+    };
+    index = BuildIndex(g, gt, cli.num_landmarks(), SSSP);
+  }
+  if (cli.index_out() != "")
+    SaveIndex(index, cli.index_out());
+  // queries are between random non-isolated vertices (or from -r if given)
+  SourcePicker<WGraph> sp(g);
+  vector<pair<NodeID, NodeID>> queries;
+  for (int q=0; q < cli.num_queries(); q++) {
+    NodeID source = sp.PickNext();
+    if (cli.start_vertex() != -1)
+      source = cli.start_vertex();
+    queries.push_back(make_pair(source, sp.PickNext()));
+  }
+  QueryStatePool state_pool(g.num_nodes());
+  auto ALTBound = [&index, &queries, &state_pool] (const WGraph &g) {
+    return RunQueries(g, index, queries, state_pool);
+  };
+  auto VerifierBound = [&queries] (const WGraph &g,
+                                   const pvector<WeightT> &answers) {
+    return ALTVerifier(g, queries, answers);
+  };
+  BenchmarkKernel(cli, g, ALTBound, PrintALTStats, VerifierBound);
+  return 0;
+}
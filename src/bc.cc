@@ -9,6 +9,7 @@
 #include "bitmap.h"
 #include "builder.h"
 #include "command_line.h"
+#include "edge_balancer.h"
 #include "graph.h"
 #include "platform_atomics.h"
 #include "pvector.h"
@@ -33,6 +34,9 @@ As an optimization to save memory, this implementation uses a Bitmap to hold
 succ (list of successors) found during the BFS phase that are used in the back-
 propagation phase.
 
+The BFS phase expands each depth with an EdgeBalancer so the frontier's edges
+are split evenly across threads even when a few vertices hold most of them.
+
 [1] Ulrik Brandes. "A faster algorithm for betweenness centrality." Journal of
     Mathematical Sociology, 25(2):163–177, 2001.
 
@@ -48,7 +52,7 @@ typedef float ScoreT;
 
 void PBFS(const Graph &g, NodeID source, pvector<NodeID> &path_counts,
     Bitmap &succ, vector<SlidingQueue<NodeID>::iterator> &depth_index,
-    SlidingQueue<NodeID> &queue) {
+    SlidingQueue<NodeID> &queue, EdgeBalancer<Graph> &balancer) {
   pvector<NodeID> depths(g.num_nodes(), -1);
   depths[source] = 0;
   path_counts[source] = 1;
@@ -64,20 +68,17 @@ void PBFS(const Graph &g, NodeID source, pvector<NodeID> &path_counts,
       #pragma omp single
       depth_index.push_back(queue.begin());
       depth++;
-      #pragma omp for schedule(dynamic, 64)
-      for (auto q_iter = queue.begin(); q_iter < queue.end(); q_iter++) {
-        NodeID u = *q_iter;
-        for (NodeID &v : g.out_neigh(u)) {
-          if ((depths[v] == -1) &&
-              (compare_and_swap(depths[v], static_cast<NodeID>(-1), depth))) {
-            lqueue.push_back(v);
-          }
-          if (depths[v] == depth) {
-            succ.set_bit_atomic(&v - g_out_start);
-            fetch_and_add(path_counts[v], path_counts[u]);
-          }
+      balancer.ForEachEdge(queue.begin(), queue.end(),
+                           [&](NodeID u, NodeID &v) {
+        if ((depths[v] == -1) &&
+            (compare_and_swap(depths[v], static_cast<NodeID>(-1), depth))) {
+          lqueue.push_back(v);
         }
-      }
+        if (depths[v] == depth) {
+          succ.set_bit_atomic(&v - g_out_start);
+          fetch_and_add(path_counts[v], path_counts[u]);
+        }
+      });
       lqueue.flush();
       #pragma omp barrier
       #pragma omp single
@@ -97,6 +98,7 @@ pvector<ScoreT> Brandes(const Graph &g, SourcePicker<Graph> &sp,
   Bitmap succ(g.num_edges_directed());
   vector<SlidingQueue<NodeID>::iterator> depth_index;
   SlidingQueue<NodeID> queue(g.num_nodes());
+  EdgeBalancer<Graph> balancer(g);
   t.Stop();
   PrintStep("a", t.Seconds());
   const NodeID* g_out_start = g.out_neigh(0).begin();
@@ -108,7 +110,7 @@ pvector<ScoreT> Brandes(const Graph &g, SourcePicker<Graph> &sp,
     depth_index.resize(0);
     queue.reset();
     succ.reset();
-    PBFS(g, source, path_counts, succ, depth_index, queue);
+    PBFS(g, source, path_counts, succ, depth_index, queue, balancer);
     t.Stop();
     PrintStep("b", t.Seconds());
     pvector<ScoreT> deltas(g.num_nodes(), 0);
@@ -0,0 +1,239 @@
+// Copyright (c) 2015, The Regents of the University of California (Regents)
+// See LICENSE.txt for license details
+
+#ifndef BFS_H_
+#define BFS_H_
+
+#include <cinttypes>
+#include <iostream>
+#include <vector>
+
+#include "benchmark.h"
+#include "bitmap.h"
+#include "edge_balancer.h"
+#include "graph.h"
+#include "platform_atomics.h"
+#include "pvector.h"
+#include "sliding_queue.h"
+#include "timer.h"
+
+
+/*
+GAP Benchmark Suite
+File:   Breadth-First Search
+
+Direction-optimizing BFS (DOBFS) over a Graph, its stats, and its verifier
+ - DOBFS is described with the bfs kernel (bfs.cc)
+ - Shared so other kernels (e.g. bfs_inc building its starting tree) can run
+   the same search bfs is benchmarked with
+*/
+
+
+// unvisited holds a superset of the unvisited vertices, and bits of vertices
+// found to be visited are cleared as they are encountered
+int64_t BUStep(const Graph &g, pvector<NodeID> &parent, HierBitmap &front,
+               HierBitmap &next, HierBitmap &unvisited) {
+  int64_t awake_count = 0;
+  next.reset();
+  #pragma omp parallel for reduction(+ : awake_count) schedule(dynamic, 1)
+  for (size_t b=0; b < unvisited.num_blocks(); b++) {
+    unvisited.for_each_set_bit_in_block(b, [&](NodeID u) {
+      if (parent[u] < 0) {
+        for (NodeID v : g.in_neigh(u)) {
+          if (front.get_bit(v)) {
+            parent[u] = v;
+            awake_count++;
+            next.set_bit(u);
+            break;
+          }
+        }
+      }
+      if (parent[u] >= 0)
+        unvisited.clear_bit(u);
+    });
+  }
+  return awake_count;
+}
+
+
+int64_t TDStep(const Graph &g, pvector<NodeID> &parent,
+               SlidingQueue<NodeID> &queue, EdgeBalancer<Graph> &balancer) {
+  int64_t scout_count = 0;
+  #pragma omp parallel
+  {
+    QueueBuffer<NodeID> lqueue(queue);
+    int64_t local_scout_count = 0;
+    balancer.ForEachEdge(queue.begin(), queue.end(),
+                         [&](NodeID u, NodeID v) {
+      NodeID curr_val = parent[v];
+      if (curr_val < 0) {
+        if (compare_and_swap(parent[v], curr_val, u)) {
+          lqueue.push_back(v);
+          local_scout_count += -curr_val;
+        }
+      }
+    });
+    lqueue.flush();
+    fetch_and_add(scout_count, local_scout_count);
+  }
+  return scout_count;
+}
+
+
+void QueueToBitmap(const SlidingQueue<NodeID> &queue, HierBitmap &bm) {
+  #pragma omp parallel for
+  for (auto q_iter = queue.begin(); q_iter < queue.end(); q_iter++) {
+    NodeID u = *q_iter;
+    bm.set_bit_atomic(u);
+  }
+}
+
+void BitmapToQueue(const Graph &g, const HierBitmap &bm,
+                   SlidingQueue<NodeID> &queue) {
+  #pragma omp parallel
+  {
+    QueueBuffer<NodeID> lqueue(queue);
+    #pragma omp for
+    for (size_t b=0; b < bm.num_blocks(); b++)
+      bm.for_each_set_bit_in_block(b, [&](NodeID n) { lqueue.push_back(n); });
+    lqueue.flush();
+  }
+  queue.slide_window();
+}
+
+pvector<NodeID> InitParent(const Graph &g) {
+  pvector<NodeID> parent(g.num_nodes());
+  #pragma omp parallel for
+  for (NodeID n=0; n < g.num_nodes(); n++)
+    parent[n] = g.out_degree(n) != 0 ? -g.out_degree(n) : -1;
+  return parent;
+}
+
+pvector<NodeID> DOBFS(const Graph &g, NodeID source, int alpha = 15,
+                      int beta = 18) {
+  PrintStep("Source", static_cast<int64_t>(source));
+  Timer t;
+  t.Start();
+  pvector<NodeID> parent = InitParent(g);
+  t.Stop();
+  PrintStep("i", t.Seconds());
+  parent[source] = source;
+  SlidingQueue<NodeID> queue(g.num_nodes());
+  queue.push_back(source);
+  queue.slide_window();
+  HierBitmap curr(g.num_nodes());
+  HierBitmap front(g.num_nodes());
+  HierBitmap unvisited(g.num_nodes());
+  bool unvisited_ready = false;
+  EdgeBalancer<Graph> balancer(g);
+  int64_t edges_to_check = g.num_edges_directed();
+  int64_t scout_count = g.out_degree(source);
+  while (!queue.empty()) {
+    if (scout_count > edges_to_check / alpha) {
+      int64_t awake_count, old_awake_count;
+      if (!unvisited_ready) {
+        unvisited.set_all();
+        unvisited_ready = true;
+      }
+      TIME_OP(t, QueueToBitmap(queue, front));
+      PrintStep("e", t.Seconds());
+      awake_count = queue.size();
+      queue.slide_window();
+      do {
+        t.Start();
+        old_awake_count = awake_count;
+        awake_count = BUStep(g, parent, front, curr, unvisited);
+        front.swap(curr);
+        t.Stop();
+        PrintStep("bu", t.Seconds(), awake_count);
+      } while ((awake_count >= old_awake_count) ||
+               (awake_count > g.num_nodes() / beta));
+      TIME_OP(t, BitmapToQueue(g, front, queue));
+      PrintStep("c", t.Seconds());
+      scout_count = 1;
+    } else {
+      t.Start();
+      edges_to_check -= scout_count;
+      scout_count = TDStep(g, parent, queue, balancer);
+      queue.slide_window();
+      t.Stop();
+      PrintStep("td", t.Seconds(), queue.size());
+    }
+  }
+  #pragma omp parallel for
+  for (NodeID n = 0; n < g.num_nodes(); n++)
+    if (parent[n] < -1)
+      parent[n] = -1;
+  return parent;
+}
+
+
+void PrintBFSStats(const Graph &g, const pvector<NodeID> &bfs_tree) {
+  int64_t tree_size = 0;
+  int64_t n_edges = 0;
+  for (NodeID n : g.vertices()) {
+    if (bfs_tree[n] >= 0) {
+      n_edges += g.out_degree(n);
+      tree_size++;
+    }
+  }
+  std::cout << "BFS Tree has " << tree_size << " nodes and ";
+  std::cout << n_edges << " edges" << std::endl;
+}
+
+
+// BFS verifier does a serial BFS from same source and asserts:
+// - parent[source] = source
+// - parent[v] = u  =>  depth[v] = depth[u] + 1 (except for source)
+// - parent[v] = u  => there is edge from u to v
+// - all vertices reachable from source have a parent
+bool BFSVerifier(const Graph &g, NodeID source,
+                 const pvector<NodeID> &parent) {
+  pvector<int> depth(g.num_nodes(), -1);
+  depth[source] = 0;
+  std::vector<NodeID> to_visit;
+  to_visit.reserve(g.num_nodes());
+  to_visit.push_back(source);
+  for (auto it = to_visit.begin(); it != to_visit.end(); it++) {
+    NodeID u = *it;
+    for (NodeID v : g.out_neigh(u)) {
+      if (depth[v] == -1) {
+        depth[v] = depth[u] + 1;
+        to_visit.push_back(v);
+      }
+    }
+  }
+  for (NodeID u : g.vertices()) {
+    if ((depth[u] != -1) && (parent[u] != -1)) {
+      if (u == source) {
+        if (!((parent[u] == u) && (depth[u] == 0))) {
+          std::cout << "Source wrong" << std::endl;
+          return false;
+        }
+        continue;
+      }
+      bool parent_found = false;
+      for (NodeID v : g.in_neigh(u)) {
+        if (v == parent[u]) {
+          if (depth[v] != depth[u] - 1) {
+            std::cout << "Wrong depths for " << u << " & " << v << std::endl;
+            return false;
+          }
+          parent_found = true;
+          break;
+        }
+      }
+      if (!parent_found) {
+        std::cout << "Couldn't find edge from " << parent[u] << " to " << u
+                  << std::endl;
+        return false;
+      }
+    } else if (depth[u] != parent[u]) {
+      std::cout << "Reachability mismatch" << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+#endif  // BFS_H_
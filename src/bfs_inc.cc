@@ -0,0 +1,97 @@
+// Copyright (c) 2015, The Regents of the University of California (Regents)
+// See LICENSE.txt for license details
+
+#include <iostream>
+#include <vector>
+
+#include "benchmark.h"
+#include "bfs.h"
+#include "builder.h"
+#include "command_line.h"
+#include "dynamic_graph.h"
+#include "edge_update.h"
+#include "graph.h"
+#include "path_repair.h"
+#include "pvector.h"
+#include "shortest_path.h"
+
+
+/*
+GAP Benchmark Suite
+Kernel: Incremental Breadth-First Search (BFS)
+
+Will return parent array for a BFS traversal from a source vertex, repaired
+from the BFS tree it had before a batch of edge updates
+
+Before the trials, a batch of random edge updates (-b updates, -p percent of
+them deletions) is generated for the input graph (UpdateGenerator) and applied
+to a DynamicGraph of the input graph, whose update rate is reported. The old
+graph is searched from the source with DOBFS, and each trial repairs a copy of
+that tree on the DynamicGraph with RepairPaths (path_repair.h) rather than
+searching it again. Each trial is checked by the BFS verifier on the updated
+graph made independently by Builder::ApplyUpdates, so it must match what a
+fresh DOBFS would find.
+*/
+
+
+using namespace std;
+
+// Depth of each vertex in the BFS tree given by parent (kDistInf if not in it)
+pvector<WeightT> DepthsFromParents(const pvector<NodeID> &parent) {
+  pvector<WeightT> depth(parent.size(), -1);
+  for (size_t v=0; v < parent.size(); v++) {
+    if (parent[v] == -1)
+      depth[v] = kDistInf;
+    else if (parent[v] == static_cast<NodeID>(v))
+      depth[v] = 0;
+  }
+  vector<NodeID> path;
+  for (size_t v=0; v < parent.size(); v++) {
+    NodeID u = v;
+    while (depth[u] == -1) {
+      path.push_back(u);
+      u = parent[u];
+    }
+    while (!path.empty()) {
+      depth[path.back()] = depth[u] + 1;
+      u = path.back();
+      path.pop_back();
+    }
+  }
+  return depth;
+}
+
+
+int main(int argc, char* argv[]) {
+  CLUpdate cli(argc, argv, "incremental breadth-first search");
+  if (!cli.ParseArgs())
+    return -1;
+  Builder b(cli);
+  Graph g_old = b.MakeGraph();
+  UpdateGenerator<NodeID> updates(g_old, cli.batch_size(),
+                                  cli.delete_percent());
+  UpdateBatch<NodeID> batch = updates.NextBatch();
+  Graph g = Builder::ApplyUpdates(g_old, batch.insertions, batch.deletions);
+  DynamicGraph<NodeID> dg(g_old);
+  dg.ApplyBatch(batch.insertions, batch.deletions);
+  SourcePicker<Graph> sp(g_old, cli.start_vertex());
+  NodeID source = sp.PickNext();
+  pvector<NodeID> old_parent = DOBFS(g_old, source);
+  pvector<WeightT> old_depth = DepthsFromParents(old_parent);
+  typedef DynamicGraph<NodeID> DGraph;
+  auto RepairBound = [&batch, &old_parent, &old_depth] (const DGraph &dg) {
+    pvector<NodeID> parent(old_parent.begin(), old_parent.end());
+    pvector<WeightT> depth(old_depth.begin(), old_depth.end());
+    RepairPaths(dg, batch, depth, parent);
+    return parent;
+  };
+  auto StatsBound = [&g] (const DGraph &, const pvector<NodeID> &parent) {
+    PrintBFSStats(g, parent);
+  };
+  auto VerifierBound = [&g, source] (const DGraph &,
+                                     const pvector<NodeID> &parent) {
+    return BFSVerifier(g, source, parent);
+  };
+  BenchmarkKernel(cli, dg, RepairBound, StatsBound, VerifierBound);
+  return 0;
+}
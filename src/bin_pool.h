@@ -0,0 +1,161 @@
+// Copyright (c) 2015, The Regents of the University of California (Regents)
+// See LICENSE.txt for license details
+
+#ifndef BIN_POOL_H_
+#define BIN_POOL_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+#include "util.h"
+
+
+/*
+GAP Benchmark Suite
+Class:  LocalBins
+
+Thread-local bins (e.g. delta-stepping buckets) built from pooled blocks
+ - Each bin is a list of fixed-size blocks, and emptying a bin returns its
+   blocks to a free list, so storage is recycled between bins rather than
+   every bin index holding onto its own capacity
+ - Bins are indexed by absolute bin number, and an unused bin costs only
+   its index entry
+ - Not thread-safe, each thread should use its own (see BinPool)
+
+Class:  BinPool
+
+One LocalBins per thread that outlives the parallel regions using it
+ - Keeping a BinPool around lets later searches (e.g. trials) reuse blocks
+*/
+
+
+template <typename T_>
+class LocalBins {
+  static const size_t kBlockSize = 256;
+
+  struct Block {
+    Block *next;
+    size_t size;
+    T_ items[kBlockSize];
+  };
+
+  struct Bin {
+    Block *head;
+    size_t size;
+  };
+
+  std::vector<Bin> bins_;
+  Block *free_list_;
+
+  Block* NewBlock(Block *next) {
+    Block *block = free_list_;
+    if (block != nullptr)
+      free_list_ = block->next;
+    else
+      block = new Block;
+    block->next = next;
+    block->size = 0;
+    return block;
+  }
+
+  // Moves every block in list to the free list
+  void Recycle(Block *block) {
+    while (block != nullptr) {
+      Block *next = block->next;
+      block->next = free_list_;
+      free_list_ = block;
+      block = next;
+    }
+  }
+
+  static void DeleteList(Block *block) {
+    while (block != nullptr) {
+      Block *next = block->next;
+      delete block;
+      block = next;
+    }
+  }
+
+ public:
+  LocalBins() : free_list_(nullptr) {}
+
+  LocalBins(const LocalBins &other) = delete;
+
+  ~LocalBins() {
+    for (Bin &bin : bins_)
+      DeleteList(bin.head);
+    DeleteList(free_list_);
+  }
+
+  // One past the highest bin index that has been used
+  size_t num_bins() const {
+    return bins_.size();
+  }
+
+  bool empty(size_t bin) const {
+    return (bin >= bins_.size()) || (bins_[bin].size == 0);
+  }
+
+  size_t size(size_t bin) const {
+    return bin < bins_.size() ? bins_[bin].size : 0;
+  }
+
+  // Lowest index of a non-empty bin at or after start, num_bins() if none
+  size_t first_nonempty(size_t start) const {
+    for (size_t b=start; b < bins_.size(); b++)
+      if (bins_[b].size != 0)
+        return b;
+    return bins_.size();
+  }
+
+  void push_back(size_t bin, T_ to_add) {
+    if (bin >= bins_.size())
+      bins_.resize(bin+1, Bin{nullptr, 0});
+    Bin &dest = bins_[bin];
+    if ((dest.head == nullptr) || (dest.head->size == kBlockSize))
+      dest.head = NewBlock(dest.head);
+    dest.head->items[dest.head->size++] = to_add;
+    dest.size++;
+  }
+
+  // Copies out contents of bin (in no particular order) and empties it
+  void drain(size_t bin, T_ *dest) {
+    if (bin >= bins_.size())
+      return;
+    for (Block *block = bins_[bin].head; block != nullptr; block = block->next)
+      dest = std::copy(block->items, block->items + block->size, dest);
+    Recycle(bins_[bin].head);
+    bins_[bin].head = nullptr;
+    bins_[bin].size = 0;
+  }
+
+  void drain(size_t bin, std::vector<T_> &dest) {
+    dest.resize(size(bin));
+    drain(bin, dest.data());
+  }
+
+  // Empties all bins but keeps their blocks for reuse
+  void clear() {
+    for (Bin &bin : bins_)
+      Recycle(bin.head);
+    bins_.clear();
+  }
+};
+
+
+template <typename T_>
+class BinPool {
+  std::vector<LocalBins<T_>> thread_bins_;
+
+ public:
+  BinPool() : thread_bins_(MaxThreads()) {}
+
+  // Bins of calling thread, must be called from a region with at most
+  // MaxThreads() threads as of the pool's construction
+  LocalBins<T_>& local() {
+    return thread_bins_[ThreadNum()];
+  }
+};
+
+#endif  // BIN_POOL_H_
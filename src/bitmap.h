@@ -17,6 +17,10 @@ Author: Scott Beamer
 
 Parallel bitmap that is thread-safe
  - Can set bits in parallel (set_bit_atomic) unlike std::vector<bool>
+ - Whole-bitmap operations (reset, count, and_with, ...) work a word at a time
+   and are parallelized, so call them from outside of parallel regions
+ - Set bits can be visited in order a word at a time by skipping to the next
+   set bit with count-trailing-zeros instead of testing every position
 */
 
 
@@ -33,25 +37,79 @@ class Bitmap {
   }
 
   void reset() {
-    std::fill(start_, end_, 0);
+    #pragma omp parallel for
+    for (uint64_t *word = start_; word < end_; word++)
+      *word = 0;
   }
 
   void set_bit(size_t pos) {
     start_[word_offset(pos)] |= ((uint64_t) 1l << bit_offset(pos));
   }
 
-  void set_bit_atomic(size_t pos) {
-    uint64_t old_val, new_val;
-    do {
-      old_val = start_[word_offset(pos)];
-      new_val = old_val | ((uint64_t) 1l << bit_offset(pos));
-    } while (!compare_and_swap(start_[word_offset(pos)], old_val, new_val));
+  // Returns true if this call is the one that changed the bit
+  bool set_bit_atomic(size_t pos) {
+    uint64_t mask = (uint64_t) 1l << bit_offset(pos);
+    return !(fetch_and_or(start_[word_offset(pos)], mask) & mask);
+  }
+
+  void clear_bit_atomic(size_t pos) {
+    fetch_and_and(start_[word_offset(pos)],
+                  ~((uint64_t) 1l << bit_offset(pos)));
   }
 
   bool get_bit(size_t pos) const {
     return (start_[word_offset(pos)] >> bit_offset(pos)) & 1l;
   }
 
+  // Number of set bits
+  int64_t count() const {
+    int64_t total = 0;
+    #pragma omp parallel for reduction(+ : total)
+    for (uint64_t *word = start_; word < end_; word++)
+      total += popcount(*word);
+    return total;
+  }
+
+  void and_with(const Bitmap &other) {
+    #pragma omp parallel for
+    for (size_t w=0; w < num_words(); w++)
+      start_[w] &= other.start_[w];
+  }
+
+  void or_with(const Bitmap &other) {
+    #pragma omp parallel for
+    for (size_t w=0; w < num_words(); w++)
+      start_[w] |= other.start_[w];
+  }
+
+  // Clears every bit that is set in other
+  void andnot_with(const Bitmap &other) {
+    #pragma omp parallel for
+    for (size_t w=0; w < num_words(); w++)
+      start_[w] &= ~other.start_[w];
+  }
+
+  size_t num_words() const {
+    return end_ - start_;
+  }
+
+  // Calls f(pos) for each set bit in word w in increasing order
+  template <typename Func>
+  void for_each_set_bit_in_word(size_t w, Func f) const {
+    uint64_t word = start_[w];
+    while (word != 0) {
+      f(w * kBitsPerWord + count_trailing_zeros(word));
+      word &= word - 1;
+    }
+  }
+
+  // Serially calls f(pos) for each set bit in increasing order
+  template <typename Func>
+  void for_each_set_bit(Func f) const {
+    for (size_t w=0; w < num_words(); w++)
+      for_each_set_bit_in_word(w, f);
+  }
+
   void swap(Bitmap &other) {
     std::swap(start_, other.start_);
     std::swap(end_, other.end_);
@@ -60,10 +118,144 @@ class Bitmap {
  private:
   uint64_t *start_;
   uint64_t *end_;
+  friend class HierBitmap;
 
   static const uint64_t kBitsPerWord = 64;
   static uint64_t word_offset(size_t n) { return n / kBitsPerWord; }
   static uint64_t bit_offset(size_t n) { return n & (kBitsPerWord - 1); }
+
+  static int popcount(uint64_t word) {
+#if defined __GNUC__
+    return __builtin_popcountll(word);
+#else
+    int total = 0;
+    for (; word != 0; word &= word - 1)
+      total++;
+    return total;
+#endif
+  }
+
+  // Undefined for word == 0
+  static int count_trailing_zeros(uint64_t word) {
+#if defined __GNUC__
+    return __builtin_ctzll(word);
+#else
+    int zeros = 0;
+    for (; !(word & 1); word >>= 1)
+      zeros++;
+    return zeros;
+#endif
+  }
+};
+
+
+
+/*
+Class:  HierBitmap
+
+Two-level bitmap with a summary bit for each word that says if it is non-zero
+ - Same single-bit interface as Bitmap, so it can stand in for one
+ - Iterating over set bits and reset() only touch words flagged in the
+   summary, so their cost is proportional to the occupied parts of the map
+ - Work is divided into blocks of 64 words (one summary word each). Plain
+   set_bit and clear_bit are only safe from the one thread handling that block
+*/
+
+class HierBitmap {
+ public:
+  explicit HierBitmap(size_t size)
+      : size_(size), bits_(size), summary_(bits_.num_words()) {
+    bits_.reset();
+    summary_.reset();
+  }
+
+  // Only clears words whose summary bit is set
+  void reset() {
+    #pragma omp parallel for
+    for (size_t b=0; b < num_blocks(); b++) {
+      summary_.for_each_set_bit_in_word(b, [this](size_t w) {
+        bits_.start_[w] = 0;
+      });
+      summary_.start_[b] = 0;
+    }
+  }
+
+  // Sets every bit in [0, size)
+  void set_all() {
+    SetPrefix(bits_, size_);
+    SetPrefix(summary_, bits_.num_words());
+  }
+
+  void set_bit(size_t pos) {
+    bits_.set_bit(pos);
+    summary_.set_bit(Bitmap::word_offset(pos));
+  }
+
+  // Returns true if this call is the one that changed the bit
+  bool set_bit_atomic(size_t pos) {
+    bool changed = bits_.set_bit_atomic(pos);
+    size_t w = Bitmap::word_offset(pos);
+    if (changed && !summary_.get_bit(w))
+      summary_.set_bit_atomic(w);
+    return changed;
+  }
+
+  void clear_bit(size_t pos) {
+    size_t w = Bitmap::word_offset(pos);
+    bits_.start_[w] &= ~((uint64_t) 1l << Bitmap::bit_offset(pos));
+    if (bits_.start_[w] == 0)
+      summary_.start_[Bitmap::word_offset(w)] &=
+          ~((uint64_t) 1l << Bitmap::bit_offset(w));
+  }
+
+  bool get_bit(size_t pos) const {
+    return bits_.get_bit(pos);
+  }
+
+  size_t num_blocks() const {
+    return summary_.num_words();
+  }
+
+  // Calls f(pos) for each set bit in block b in increasing order, and f may
+  // clear the bit it is given
+  template <typename Func>
+  void for_each_set_bit_in_block(size_t b, Func f) const {
+    summary_.for_each_set_bit_in_word(b, [this, &f](size_t w) {
+      bits_.for_each_set_bit_in_word(w, f);
+    });
+  }
+
+  // Serially calls f(pos) for each set bit in increasing order
+  template <typename Func>
+  void for_each_set_bit(Func f) const {
+    for (size_t b=0; b < num_blocks(); b++)
+      for_each_set_bit_in_block(b, f);
+  }
+
+  void swap(HierBitmap &other) {
+    std::swap(size_, other.size_);
+    bits_.swap(other.bits_);
+    summary_.swap(other.summary_);
+  }
+
+ private:
+  size_t size_;
+  Bitmap bits_;
+  Bitmap summary_;
+
+  // Sets first num_bits bits of bm and clears the rest
+  static void SetPrefix(Bitmap &bm, size_t num_bits) {
+    const size_t full_words = num_bits / Bitmap::kBitsPerWord;
+    #pragma omp parallel for
+    for (size_t w=0; w < bm.num_words(); w++) {
+      if (w < full_words)
+        bm.start_[w] = ~static_cast<uint64_t>(0);
+      else if (w == full_words)
+        bm.start_[w] = ((uint64_t) 1l << Bitmap::bit_offset(num_bits)) - 1;
+      else
+        bm.start_[w] = 0;
+    }
+  }
 };
 
 #endif  // BITMAP_H_
@@ -10,6 +10,7 @@
 #include <functional>
 #include <type_traits>
 #include <utility>
+#include <vector>
 
 #include "command_line.h"
 #include "generator.h"
@@ -30,6 +31,8 @@ Given arguements from the command line (cli), returns a built graph
  - MakeGraph() will parse cli and obtain edgelist and call
    MakeGraphFromEL(edgelist) to perform actual graph construction
  - edgelist can be from file (reader) or synthetically generated (generator)
+ - StreamEL(process) instead hands the edgelist over a chunk at a time, for
+   kernels that can consume edges without a graph
  - Common case: BuilderBase typedef'd (w/ params) to be Builder (benchmark.h)
 */
 
@@ -51,10 +54,11 @@ class BuilderBase {
     needs_weights_ = !std::is_same<NodeID_, DestID_>::value;
   }
 
-  DestID_ GetSource(EdgePair<NodeID_, NodeID_> e) {
+  static DestID_ GetSource(EdgePair<NodeID_, NodeID_> e) {
     return e.u;
   }
 
+  static
   DestID_ GetSource(EdgePair<NodeID_, NodeWeight<NodeID_, WeightT_>> e) {
     return NodeWeight<NodeID_, WeightT_>(e.u, e.v.w);
   }
@@ -243,16 +247,28 @@ class BuilderBase {
     return SquishGraph(g);
   }
 
-  // Relabels (and rebuilds) graph by order of decreasing degree
-  static
-  CSRGraph<NodeID_, DestID_, invert> RelabelByDegree(
-      const CSRGraph<NodeID_, DestID_, invert> &g) {
-    if (g.directed()) {
-      std::cout << "Cannot relabel directed graph" << std::endl;
-      std::exit(-11);
+  // Hands the edgelist to process a chunk at a time as it is read or
+  // generated, without ever holding all of it or building a graph (so edges
+  // are neither symmetrized nor weighted), returns false for serialized input
+  template <typename ChunkFunc>
+  bool StreamEL(ChunkFunc process, int64_t chunk_size = 1 << 22) {
+    if (cli_.filename() != "") {
+      Reader<NodeID_, DestID_, WeightT_, invert> r(cli_.filename());
+      if ((r.GetSuffix() == ".sg") || (r.GetSuffix() == ".wsg"))
+        return false;
+      r.ReadFileChunks(process, chunk_size);
+    } else if (cli_.scale() != -1) {
+      Generator<NodeID_, DestID_> gen(cli_.scale(), cli_.degree());
+      gen.GenerateELChunks(cli_.uniform(), process, chunk_size);
     }
-    Timer t;
-    t.Start();
+    return true;
+  }
+
+  // New ID of each vertex when ordered by decreasing degree (ties broken by
+  // decreasing ID), fills degrees with the degree of each new ID
+  static
+  pvector<NodeID_> DegreeOrder(const CSRGraph<NodeID_, DestID_, invert> &g,
+                               pvector<NodeID_> &degrees) {
     typedef std::pair<int64_t, NodeID_> degree_node_p;
     pvector<degree_node_p> degree_id_pairs(g.num_nodes());
     #pragma omp parallel for
@@ -260,13 +276,29 @@ class BuilderBase {
       degree_id_pairs[n] = std::make_pair(g.out_degree(n), n);
     std::sort(degree_id_pairs.begin(), degree_id_pairs.end(),
               std::greater<degree_node_p>());
-    pvector<NodeID_> degrees(g.num_nodes());
     pvector<NodeID_> new_ids(g.num_nodes());
     #pragma omp parallel for
     for (NodeID_ n=0; n < g.num_nodes(); n++) {
       degrees[n] = degree_id_pairs[n].first;
       new_ids[degree_id_pairs[n].second] = n;
     }
+    return new_ids;
+  }
+
+  // Relabels (and rebuilds) graph by order of decreasing degree, and if given
+  // new_ids_out, fills it with the new ID of each original vertex
+  static
+  CSRGraph<NodeID_, DestID_, invert> RelabelByDegree(
+      const CSRGraph<NodeID_, DestID_, invert> &g,
+      pvector<NodeID_> *new_ids_out = nullptr) {
+    if (g.directed()) {
+      std::cout << "Cannot relabel directed graph" << std::endl;
+      std::exit(-11);
+    }
+    Timer t;
+    t.Start();
+    pvector<NodeID_> degrees(g.num_nodes());
+    pvector<NodeID_> new_ids = DegreeOrder(g, degrees);
     pvector<SGOffset> offsets = ParallelPrefixSum(degrees);
     DestID_* neighs = new DestID_[offsets[g.num_nodes()]];
     DestID_** index = CSRGraph<NodeID_, DestID_>::GenIndex(offsets, neighs);
@@ -278,8 +310,236 @@ class BuilderBase {
     }
     t.Stop();
     PrintTime("Relabel", t.Seconds());
+    if (new_ids_out != nullptr)
+      new_ids_out->swap(new_ids);
     return CSRGraph<NodeID_, DestID_, invert>(g.num_nodes(), index, neighs);
   }
+
+  // Relabels undirected graph by order of decreasing degree (as
+  // RelabelByDegree) and orients each edge towards its endpoint with the
+  // lower new ID. The result is a DAG (without in-edges) with half the edges,
+  // in which no vertex has out-degree above sqrt(2|E|). If given new_ids_out,
+  // fills it with the new ID of each original vertex.
+  static
+  CSRGraph<NodeID_, DestID_, invert> OrientByDegree(
+      const CSRGraph<NodeID_, DestID_, invert> &g,
+      pvector<NodeID_> *new_ids_out = nullptr) {
+    if (g.directed()) {
+      std::cout << "Cannot orient directed graph" << std::endl;
+      std::exit(-11);
+    }
+    Timer t;
+    t.Start();
+    pvector<NodeID_> degrees(g.num_nodes());
+    pvector<NodeID_> new_ids = DegreeOrder(g, degrees);
+    #pragma omp parallel for schedule(dynamic, 1024)
+    for (NodeID_ u=0; u < g.num_nodes(); u++) {
+      NodeID_ u_new = new_ids[u];
+      degrees[u_new] = 0;
+      for (NodeID_ v : g.out_neigh(u))
+        degrees[u_new] += new_ids[v] < u_new;
+    }
+    pvector<SGOffset> offsets = ParallelPrefixSum(degrees);
+    DestID_* neighs = new DestID_[offsets[g.num_nodes()]];
+    DestID_** index = CSRGraph<NodeID_, DestID_>::GenIndex(offsets, neighs);
+    #pragma omp parallel for schedule(dynamic, 1024)
+    for (NodeID_ u=0; u < g.num_nodes(); u++) {
+      NodeID_ u_new = new_ids[u];
+      for (NodeID_ v : g.out_neigh(u)) {
+        if (new_ids[v] < u_new)
+          neighs[offsets[u_new]++] = new_ids[v];
+      }
+      std::sort(index[u_new], index[u_new+1]);
+    }
+    t.Stop();
+    PrintTime("Orient", t.Seconds());
+    if (new_ids_out != nullptr)
+      new_ids_out->swap(new_ids);
+    return CSRGraph<NodeID_, DestID_, invert>(g.num_nodes(), index, neighs,
+                                              nullptr, nullptr);
+  }
+
+  // Copy of directed graph with every edge reversed, so code that only follows
+  // out-edges can search backwards
+  static
+  CSRGraph<NodeID_, DestID_, invert> Transpose(
+      const CSRGraph<NodeID_, DestID_, invert> &g) {
+    Timer t;
+    t.Start();
+    pvector<SGOffset> out_offsets = g.VertexOffsets(true);
+    pvector<SGOffset> in_offsets = g.VertexOffsets(false);
+    DestID_* out_neighs = new DestID_[g.num_edges_directed()];
+    DestID_* in_neighs = new DestID_[g.num_edges_directed()];
+    #pragma omp parallel for
+    for (NodeID_ u=0; u < g.num_nodes(); u++) {
+      std::copy(g.in_neigh(u).begin(), g.in_neigh(u).end(),
+                out_neighs + out_offsets[u]);
+      std::copy(g.out_neigh(u).begin(), g.out_neigh(u).end(),
+                in_neighs + in_offsets[u]);
+    }
+    DestID_** out_index = CSRGraph<NodeID_, DestID_>::GenIndex(out_offsets,
+                                                               out_neighs);
+    DestID_** in_index = CSRGraph<NodeID_, DestID_>::GenIndex(in_offsets,
+                                                              in_neighs);
+    t.Stop();
+    PrintTime("Transpose", t.Seconds());
+    return CSRGraph<NodeID_, DestID_, invert>(g.num_nodes(), out_index,
+                                              out_neighs, in_index, in_neighs);
+  }
+
+  // Copy of g with the edges in deletions removed and those in insertions
+  // added (both directions of each if g is undirected), deleting an edge
+  // removes every copy of it regardless of weight
+  static
+  CSRGraph<NodeID_, DestID_, invert> ApplyUpdates(
+      const CSRGraph<NodeID_, DestID_, invert> &g, const EdgeList &insertions,
+      const EdgeList &deletions) {
+    Timer t;
+    t.Start();
+    DestID_ **out_index, *out_neighs;
+    DestID_ **in_index = nullptr, *in_neighs = nullptr;
+    UpdateCSR(g, insertions, deletions, false, &out_index, &out_neighs);
+    if (g.directed() && invert)
+      UpdateCSR(g, insertions, deletions, true, &in_index, &in_neighs);
+    t.Stop();
+    PrintTime("Update Time", t.Seconds());
+    if (g.directed())
+      return CSRGraph<NodeID_, DestID_, invert>(g.num_nodes(), out_index,
+                                                out_neighs, in_index,
+                                                in_neighs);
+    else
+      return CSRGraph<NodeID_, DestID_, invert>(g.num_nodes(), out_index,
+                                                out_neighs);
+  }
+
+  // Sorts each out-neighborhood of weighted graph in place by increasing
+  // weight, so for any threshold its light edges are a prefix (delta-stepping)
+  static
+  void SortByWeight(CSRGraph<NodeID_, DestID_, invert> &g) {
+    Timer t;
+    t.Start();
+    auto LighterThan = [](const DestID_ &a, const DestID_ &b) {
+      return a.w == b.w ? a.v < b.v : a.w < b.w;
+    };
+    #pragma omp parallel for schedule(dynamic, 1024)
+    for (NodeID_ u=0; u < g.num_nodes(); u++)
+      std::sort(g.out_neigh(u).begin(), g.out_neigh(u).end(), LighterThan);
+    t.Stop();
+    PrintTime("Weight Sort", t.Seconds());
+  }
+
+ private:
+  // Updates as (endpoint, neighbor) pairs for the neighborhoods being built,
+  // sorted by endpoint and then by neighbor
+  static EdgeList OrientUpdates(const CSRGraph<NodeID_, DestID_, invert> &g,
+                                const EdgeList &updates, bool transpose) {
+    const int64_t num_updates = updates.size();
+    const int64_t copies = g.directed() ? 1 : 2;
+    EdgeList oriented(num_updates * copies);
+    #pragma omp parallel for
+    for (int64_t i=0; i < num_updates; i++) {
+      Edge e = updates[i];
+      Edge reversed(static_cast<NodeID_>(e.v), GetSource(e));
+      if (g.directed()) {
+        oriented[i] = transpose ? reversed : e;
+      } else {
+        oriented[2*i] = e;
+        oriented[2*i + 1] = reversed;
+      }
+    }
+    std::sort(oriented.begin(), oriented.end(),
+              [](const Edge &a, const Edge &b) {
+      if (a.u != b.u)
+        return a.u < b.u;
+      return static_cast<NodeID_>(a.v) < static_cast<NodeID_>(b.v);
+    });
+    return oriented;
+  }
+
+  // Neighborhood [n_start, n_end) of n after updates, sorted and without
+  // self-loops or redundant edges (same as SquishCSR), deletions of n must be
+  // sorted by neighbor (OrientUpdates) so each lookup is a binary search
+  static void MergeUpdates(NodeID_ n, DestID_ *n_start, DestID_ *n_end,
+                           const Edge *ins_start, const Edge *ins_end,
+                           const Edge *del_start, const Edge *del_end,
+                           std::vector<DestID_> &merged) {
+    auto ByNeighbor = [](const Edge &e, NodeID_ v) {
+      return static_cast<NodeID_>(e.v) < v;
+    };
+    merged.clear();
+    for (DestID_ *it = n_start; it < n_end; it++) {
+      NodeID_ v = static_cast<NodeID_>(*it);
+      const Edge *del = std::lower_bound(del_start, del_end, v, ByNeighbor);
+      if ((del == del_end) || (static_cast<NodeID_>(del->v) != v))
+        merged.push_back(*it);
+    }
+    for (const Edge *e = ins_start; e < ins_end; e++)
+      merged.push_back(e->v);
+    std::sort(merged.begin(), merged.end());
+    merged.erase(std::unique(merged.begin(), merged.end()), merged.end());
+    merged.erase(std::remove(merged.begin(), merged.end(), n), merged.end());
+  }
+
+  // Builds the out (or in if transpose) neighborhoods of ApplyUpdates, only
+  // vertices with updates are merged, the rest are copied
+  static void UpdateCSR(const CSRGraph<NodeID_, DestID_, invert> &g,
+                        const EdgeList &insertions, const EdgeList &deletions,
+                        bool transpose, DestID_*** index, DestID_** neighs) {
+    EdgeList ins = OrientUpdates(g, insertions, transpose);
+    EdgeList dels = OrientUpdates(g, deletions, transpose);
+    const Edge *ins_first = ins.begin(), *ins_last = ins.end();
+    const Edge *dels_first = dels.begin(), *dels_last = dels.end();
+    auto ByEndpoint = [](const Edge &e, NodeID_ n) { return e.u < n; };
+    // merges neighborhood of n into merged, false if n has no updates
+    auto Merge = [&](NodeID_ n, std::vector<DestID_> &merged) {
+      const Edge *ins_start = std::lower_bound(ins_first, ins_last, n,
+                                               ByEndpoint);
+      const Edge *ins_end = std::lower_bound(ins_start, ins_last, n+1,
+                                             ByEndpoint);
+      const Edge *del_start = std::lower_bound(dels_first, dels_last, n,
+                                               ByEndpoint);
+      const Edge *del_end = std::lower_bound(del_start, dels_last, n+1,
+                                             ByEndpoint);
+      if ((ins_start == ins_end) && (del_start == del_end))
+        return false;
+      if (transpose)
+        MergeUpdates(n, g.in_neigh(n).begin(), g.in_neigh(n).end(), ins_start,
+                     ins_end, del_start, del_end, merged);
+      else
+        MergeUpdates(n, g.out_neigh(n).begin(), g.out_neigh(n).end(),
+                     ins_start, ins_end, del_start, del_end, merged);
+      return true;
+    };
+    pvector<NodeID_> degrees(g.num_nodes());
+    #pragma omp parallel
+    {
+      std::vector<DestID_> merged;
+      #pragma omp for schedule(dynamic, 1024)
+      for (NodeID_ n=0; n < g.num_nodes(); n++) {
+        if (Merge(n, merged))
+          degrees[n] = merged.size();
+        else
+          degrees[n] = transpose ? g.in_degree(n) : g.out_degree(n);
+      }
+    }
+    pvector<SGOffset> offsets = ParallelPrefixSum(degrees);
+    *neighs = new DestID_[offsets[g.num_nodes()]];
+    *index = CSRGraph<NodeID_, DestID_>::GenIndex(offsets, *neighs);
+    #pragma omp parallel
+    {
+      std::vector<DestID_> merged;
+      #pragma omp for schedule(dynamic, 1024)
+      for (NodeID_ n=0; n < g.num_nodes(); n++) {
+        if (Merge(n, merged))
+          std::copy(merged.begin(), merged.end(), (*index)[n]);
+        else if (transpose)
+          std::copy(g.in_neigh(n).begin(), g.in_neigh(n).end(), (*index)[n]);
+        else
+          std::copy(g.out_neigh(n).begin(), g.out_neigh(n).end(),
+                    (*index)[n]);
+      }
+    }
+  }
 };
 
 #endif  // BUILDER_H_
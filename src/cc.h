@@ -0,0 +1,226 @@
+// Copyright (c) 2018, The Hebrew University of Jerusalem (HUJI, A. Barak)
+// See LICENSE.txt for license details
+
+#ifndef CC_H_
+#define CC_H_
+
+#include <algorithm>
+#include <cinttypes>
+#include <iostream>
+#include <random>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "benchmark.h"
+#include "bitmap.h"
+#include "graph.h"
+#include "platform_atomics.h"
+#include "pvector.h"
+
+
+/*
+GAP Benchmark Suite
+File:   Connected Components
+
+Afforest over a Graph, the union-find steps it is built from (Link and
+Compress), its stats, and its verifier
+ - Afforest is described with the cc kernel (cc.cc)
+ - Link and Compress work on any comp array where each vertex points to a
+   vertex with an ID no greater than its own, so other kernels (e.g. cc_inc
+   absorbing edge insertions) can extend components Afforest found
+*/
+
+
+// Place nodes u and v in same component of lower component ID
+inline
+void Link(NodeID u, NodeID v, pvector<NodeID>& comp) {
+  NodeID p1 = comp[u];
+  NodeID p2 = comp[v];
+  while (p1 != p2) {
+    NodeID high = p1 > p2 ? p1 : p2;
+    NodeID low = p1 + (p2 - high);
+    NodeID p_high = comp[high];
+    // Was already 'low' or succeeded in writing 'low'
+    if ((p_high == low) ||
+        (p_high == high && compare_and_swap(comp[high], high, low)))
+      break;
+    p1 = comp[comp[high]];
+    p2 = comp[low];
+  }
+}
+
+
+// Reduce depth of tree for each component to 1 by crawling up parents
+template <typename GraphT_>
+void Compress(const GraphT_ &g, pvector<NodeID>& comp) {
+  #pragma omp parallel for schedule(static, 2048)
+  for (NodeID n = 0; n < g.num_nodes(); n++) {
+    while (comp[n] != comp[comp[n]]) {
+      comp[n] = comp[comp[n]];
+    }
+  }
+}
+
+
+// Same as above, for a comp array with no graph behind it
+inline
+void Compress(pvector<NodeID>& comp) {
+  const NodeID num_nodes = comp.size();
+  #pragma omp parallel for schedule(static, 2048)
+  for (NodeID n = 0; n < num_nodes; n++) {
+    while (comp[n] != comp[comp[n]]) {
+      comp[n] = comp[comp[n]];
+    }
+  }
+}
+
+
+NodeID SampleFrequentElement(const pvector<NodeID>& comp,
+                             int64_t num_samples = 1024,
+                             bool logging_enabled = true) {
+  std::unordered_map<NodeID, int> sample_counts(32);
+  using kvp_type = std::unordered_map<NodeID, int>::value_type;
+  // Sample elements from 'comp'
+  std::mt19937 gen;
+  std::uniform_int_distribution<NodeID> distribution(0, comp.size() - 1);
+  for (NodeID i = 0; i < num_samples; i++) {
+    NodeID n = distribution(gen);
+    sample_counts[comp[n]]++;
+  }
+  // Find most frequent element in samples (estimate of most frequent overall)
+  auto most_frequent = std::max_element(
+    sample_counts.begin(), sample_counts.end(),
+    [](const kvp_type& a, const kvp_type& b) { return a.second < b.second; });
+  float frac_of_graph = static_cast<float>(most_frequent->second) / num_samples;
+  if (logging_enabled) {
+    std::cout
+      << "Skipping largest intermediate component (ID: " << most_frequent->first
+      << ", approx. " << static_cast<int>(frac_of_graph * 100)
+      << "% of the graph)" << std::endl;
+  }
+  return most_frequent->first;
+}
+
+
+pvector<NodeID> Afforest(const Graph &g, int32_t neighbor_rounds = 2) {
+  pvector<NodeID> comp(g.num_nodes());
+
+  // Initialize each node to a single-node self-pointing tree
+  #pragma omp parallel for
+  for (NodeID n = 0; n < g.num_nodes(); n++)
+    comp[n] = n;
+
+  // Process a sparse sampled subgraph first for approximating components.
+  // Sample by processing a fixed number of neighbors for each node (see paper)
+  for (int r = 0; r < neighbor_rounds; ++r) {
+    #pragma omp parallel for
+    for (NodeID u = 0; u < g.num_nodes(); u++) {
+      for (NodeID v : g.out_neigh(u, r)) {
+        // Link at most one time if neighbor available at offset r
+        Link(u, v, comp);
+        break;
+      }
+    }
+    Compress(g, comp);
+  }
+
+  // Sample 'comp' to find the most frequent element -- due to prior
+  // compression, this value represents the largest intermediate component
+  NodeID c = SampleFrequentElement(comp);
+
+  // Final 'link' phase over remaining edges (excluding largest component)
+  if (!g.directed()) {
+    #pragma omp parallel for schedule(dynamic, 2048)
+    for (NodeID u = 0; u < g.num_nodes(); u++) {
+      // Skip processing nodes in the largest component
+      if (comp[u] == c)
+        continue;
+      // Skip over part of neighborhood (determined by neighbor_rounds)
+      for (NodeID v : g.out_neigh(u, neighbor_rounds)) {
+        Link(u, v, comp);
+      }
+    }
+  } else {
+    #pragma omp parallel for schedule(dynamic, 2048)
+    for (NodeID u = 0; u < g.num_nodes(); u++) {
+      if (comp[u] == c)
+        continue;
+      for (NodeID v : g.out_neigh(u, neighbor_rounds)) {
+        Link(u, v, comp);
+      }
+      // To support directed graphs, process reverse graph completely
+      for (NodeID v : g.in_neigh(u)) {
+        Link(u, v, comp);
+      }
+    }
+  }
+  // Finally, 'compress' for final convergence
+  Compress(g, comp);
+  return comp;
+}
+
+
+void PrintCompStats(const Graph &g, const pvector<NodeID> &comp) {
+  std::cout << std::endl;
+  std::unordered_map<NodeID, NodeID> count;
+  for (NodeID comp_i : comp)
+    count[comp_i] += 1;
+  int k = 5;
+  std::vector<std::pair<NodeID, NodeID>> count_vector;
+  count_vector.reserve(count.size());
+  for (auto kvp : count)
+    count_vector.push_back(kvp);
+  std::vector<std::pair<NodeID, NodeID>> top_k = TopK(count_vector, k);
+  k = std::min(k, static_cast<int>(top_k.size()));
+  std::cout << k << " biggest clusters" << std::endl;
+  for (auto kvp : top_k)
+    std::cout << kvp.second << ":" << kvp.first << std::endl;
+  std::cout << "There are " << count.size() << " components" << std::endl;
+}
+
+
+// Verifies CC result by performing a BFS from a vertex in each component
+// - Asserts search does not reach a vertex with a different component label
+// - If the graph is directed, it performs the search as if it was undirected
+// - Asserts every vertex is visited (degree-0 vertex should have own label)
+bool CCVerifier(const Graph &g, const pvector<NodeID> &comp) {
+  std::unordered_map<NodeID, NodeID> label_to_source;
+  for (NodeID n : g.vertices())
+    label_to_source[comp[n]] = n;
+  Bitmap visited(g.num_nodes());
+  visited.reset();
+  std::vector<NodeID> frontier;
+  frontier.reserve(g.num_nodes());
+  for (auto label_source_pair : label_to_source) {
+    NodeID curr_label = label_source_pair.first;
+    NodeID source = label_source_pair.second;
+    frontier.clear();
+    frontier.push_back(source);
+    visited.set_bit(source);
+    for (auto it = frontier.begin(); it != frontier.end(); it++) {
+      NodeID u = *it;
+      for (NodeID v : g.out_neigh(u)) {
+        if (comp[v] != curr_label)
+          return false;
+        if (!visited.get_bit(v)) {
+          visited.set_bit(v);
+          frontier.push_back(v);
+        }
+      }
+      if (g.directed()) {
+        for (NodeID v : g.in_neigh(u)) {
+          if (comp[v] != curr_label)
+            return false;
+          if (!visited.get_bit(v)) {
+            visited.set_bit(v);
+            frontier.push_back(v);
+          }
+        }
+      }
+    }
+  }
+  return visited.count() == g.num_nodes();
+}
+
+#endif  // CC_H_
@@ -0,0 +1,166 @@
+// Copyright (c) 2015, The Regents of the University of California (Regents)
+// See LICENSE.txt for license details
+
+#include <cinttypes>
+#include <iostream>
+#include <vector>
+
+#include "benchmark.h"
+#include "bitmap.h"
+#include "builder.h"
+#include "cc.h"
+#include "command_line.h"
+#include "dynamic_graph.h"
+#include "edge_update.h"
+#include "graph.h"
+#include "pvector.h"
+#include "sliding_queue.h"
+#include "timer.h"
+
+
+/*
+GAP Benchmark Suite
+Kernel: Incremental Connected Components (CC)
+
+Will return comp array labelling each vertex with a connected component ID,
+kept up to date over a stream of edge updates
+
+Before the trials, the components of the input graph are found by Afforest
+(cc.h), and a batch of random edge updates (-b updates, -p percent of them
+deletions, from UpdateGenerator) is generated for each trial. Each trial
+applies its batch to a DynamicGraph of the input graph and updates comp from
+where the previous trial left it, so the trial time is the latency of a batch.
+
+Since comp is a union-find forest, inserted edges are absorbed by Link
+directly. A deleted edge can split its component, so each component with a
+deletion is dissolved and found again by the Afforest steps restricted to its
+vertices, which are the only ones with edges into it (other than inserted
+edges, which are linked afterwards). Other vertices keep their labels.
+
+Each trial is checked against Afforest rerun on the updated graph
+(DynamicGraph::Compact), which must find the same components.
+*/
+
+
+using namespace std;
+
+typedef DynamicGraph<NodeID> DGraph;
+
+
+// Afforest (cc.h) over only the vertices in members
+void RelinkMembers(const DGraph &g, const SlidingQueue<NodeID> &members,
+                   pvector<NodeID> &comp, bool logging_enabled = true,
+                   int32_t neighbor_rounds = 2) {
+  #pragma omp parallel for
+  for (auto it = members.begin(); it < members.end(); it++)
+    comp[*it] = *it;
+  for (int r = 0; r < neighbor_rounds; ++r) {
+    #pragma omp parallel for
+    for (auto it = members.begin(); it < members.end(); it++) {
+      for (NodeID v : g.out_neigh(*it, r)) {
+        Link(*it, v, comp);
+        break;
+      }
+    }
+    #pragma omp parallel for schedule(static, 2048)
+    for (auto it = members.begin(); it < members.end(); it++) {
+      NodeID n = *it;
+      while (comp[n] != comp[comp[n]])
+        comp[n] = comp[comp[n]];
+    }
+  }
+  pvector<NodeID> member_comps(members.size());
+  #pragma omp parallel for
+  for (size_t i=0; i < member_comps.size(); i++)
+    member_comps[i] = comp[members.begin()[i]];
+  NodeID c = SampleFrequentElement(member_comps, 1024, logging_enabled);
+  #pragma omp parallel for schedule(dynamic, 2048)
+  for (auto it = members.begin(); it < members.end(); it++) {
+    NodeID u = *it;
+    if (comp[u] == c)
+      continue;
+    for (NodeID v : g.out_neigh(u, neighbor_rounds))
+      Link(u, v, comp);
+    if (g.directed()) {
+      for (NodeID v : g.in_neigh(u))
+        Link(u, v, comp);
+    }
+  }
+}
+
+
+// Updates comp for batch, which has already been applied to g
+void UpdateComponents(const DGraph &g, const UpdateBatch<NodeID> &batch,
+                      pvector<NodeID> &comp, bool logging_enabled = true) {
+  SlidingQueue<NodeID> members(g.num_nodes());
+  if (batch.deletions.size() != 0) {
+    Bitmap dissolved(g.num_nodes());
+    dissolved.reset();
+    #pragma omp parallel for
+    for (size_t i=0; i < batch.deletions.size(); i++)
+      dissolved.set_bit_atomic(comp[batch.deletions[i].u]);
+    #pragma omp parallel
+    {
+      QueueBuffer<NodeID> lmembers(members);
+      #pragma omp for nowait
+      for (NodeID n = 0; n < g.num_nodes(); n++) {
+        if (dissolved.get_bit(comp[n]))
+          lmembers.push_back(n);
+      }
+      lmembers.flush();
+    }
+    members.slide_window();
+    RelinkMembers(g, members, comp, logging_enabled);
+  }
+  #pragma omp parallel for
+  for (size_t i=0; i < batch.insertions.size(); i++)
+    Link(batch.insertions[i].u, batch.insertions[i].v, comp);
+  Compress(g, comp);
+  if (logging_enabled)
+    PrintStep("Dissolved", static_cast<int64_t>(members.size()));
+}
+
+
+// Both labellings are compressed (each label is a vertex in its component),
+// so they agree if each maps the other's labels onto its own
+bool SamePartition(const pvector<NodeID> &a, const pvector<NodeID> &b) {
+  for (size_t n=0; n < a.size(); n++) {
+    if ((b[a[n]] != b[n]) || (a[b[n]] != a[n]))
+      return false;
+  }
+  return true;
+}
+
+
+int main(int argc, char* argv[]) {
+  CLUpdate cli(argc, argv, "incremental connected-components");
+  if (!cli.ParseArgs())
+    return -1;
+  Builder b(cli);
+  Graph g = b.MakeGraph();
+  UpdateGenerator<NodeID> updates(g, cli.batch_size(), cli.delete_percent());
+  vector<UpdateBatch<NodeID>> batches;
+  for (int i=0; i < cli.num_trials(); i++)
+    batches.push_back(updates.NextBatch());
+  Timer t;
+  t.Start();
+  pvector<NodeID> comp = Afforest(g);
+  t.Stop();
+  PrintTime("Initial Time", t.Seconds());
+  DGraph dg(g);
+  size_t num_applied = 0;
+  auto UpdateBound = [&] (const DGraph &) {
+    const UpdateBatch<NodeID> &batch = batches[num_applied++];
+    dg.ApplyBatch(batch.insertions, batch.deletions);
+    UpdateComponents(dg, batch, comp);
+    return &comp;
+  };
+  auto StatsBound = [] (const DGraph &dg, const pvector<NodeID> *comp) {
+    PrintCompStats(dg.Compact(), *comp);
+  };
+  auto VerifierBound = [] (const DGraph &dg, const pvector<NodeID> *comp) {
+    return SamePartition(*comp, Afforest(dg.Compact()));
+  };
+  BenchmarkKernel(cli, dg, UpdateBound, StatsBound, VerifierBound);
+  return 0;
+}
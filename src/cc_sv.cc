@@ -143,10 +143,7 @@ bool CCVerifier(const Graph &g, const pvector<NodeID> &comp) {
       }
     }
   }
-  for (NodeID n=0; n < g.num_nodes(); n++)
-    if (!visited.get_bit(n))
-      return false;
-  return true;
+  return visited.count() == g.num_nodes();
 }
 
 
@@ -0,0 +1,289 @@
+// Copyright (c) 2015, The Regents of the University of California (Regents)
+// See LICENSE.txt for license details
+
+#include <algorithm>
+#include <cinttypes>
+#include <iostream>
+#include <vector>
+
+#include "benchmark.h"
+#include "builder.h"
+#include "command_line.h"
+#include "graph.h"
+#include "platform_atomics.h"
+#include "pvector.h"
+#include "sliding_queue.h"
+
+
+/*
+GAP Benchmark Suite
+Kernel: Graph Coloring (color)
+
+Will return a color for every vertex such that no two neighbors share one,
+trying to use few colors
+
+Requires input graph:
+  - to be undirected
+  - no self loops
+
+Vertices are ordered by a priority: largest log-degree first, with ties
+broken pseudorandomly (by hashing with kRandSeed) and then by ID, as in [1].
+Each vertex takes the smallest color none of its colored neighbors has (first
+fit), so no vertex gets a color above its degree.
+
+By default, this runs speculative greedy coloring [2]. Every vertex in the
+worklist (at first all of them, by decreasing log-degree) is colored in
+parallel, reading its neighbors' colors even as they change. Afterwards, a
+vertex in the worklist with the same color as a neighbor that precedes it goes
+into the next worklist to be colored again, until there are no such
+conflicts.
+
+With -j, it instead runs Jones-Plassmann [3]. Each vertex counts how many of
+its neighbors precede it, and is colored once all of them are. Each round
+colors the frontier (vertices whose count reached zero) and decrements the
+counts of the neighbors they precede (those not yet colored), which builds
+the next frontier. Since every vertex sees exactly the colors of the neighbors
+that precede it, the coloring is the same as serial greedy in priority order.
+
+[1] William Hasenplaugh, Tim Kaler, Tao B. Schardl, and Charles E. Leiserson.
+    "Ordering heuristics for parallel graph coloring." ACM Symposium on
+    Parallelism in Algorithms and Architectures (SPAA), 2014.
+
+[2] Umit V. Catalyurek, John Feo, Assefaw H. Gebremedhin, Mahantesh
+    Halappanavar, and Alex Pothen. "Graph coloring algorithms for multi-core
+    and massively multithreaded architectures." Parallel Computing, 2012.
+
+[3] Mark T. Jones and Paul E. Plassmann. "A parallel graph coloring
+    heuristic." SIAM Journal on Scientific Computing, 1993.
+*/
+
+
+using namespace std;
+
+const NodeID kNoColor = -1;
+
+
+// Largest-log-degree-first, then pseudorandom (compare with Precedes)
+pvector<uint64_t> Priorities(const Graph &g) {
+  pvector<uint64_t> priority(g.num_nodes());
+  #pragma omp parallel for
+  for (NodeID n=0; n < g.num_nodes(); n++) {
+    uint64_t log_degree = 0;
+    for (int64_t d=g.out_degree(n); d > 0; d >>= 1)
+      log_degree++;
+    priority[n] = (log_degree << 32) | (SeededHash(n) >> 32);
+  }
+  return priority;
+}
+
+inline
+bool Precedes(const pvector<uint64_t> &priority, NodeID u, NodeID v) {
+  return priority[u] != priority[v] ? priority[u] > priority[v] : u < v;
+}
+
+
+// Smallest color that no colored neighbor of u has, where forbidden (with a
+// slot for each possible color) is marked with stamp, which must not have
+// been used before
+inline
+NodeID FirstFit(const Graph &g, NodeID u, const pvector<NodeID> &color,
+                vector<int64_t> &forbidden, int64_t stamp) {
+  for (NodeID v : g.out_neigh(u)) {
+    NodeID c = color[v];
+    if (c != kNoColor)
+      forbidden[c] = stamp;
+  }
+  NodeID c = 0;
+  while (forbidden[c] == stamp)
+    c++;
+  return c;
+}
+
+
+// Per-thread forbidden arrays for FirstFit, kept across rounds
+class ForbiddenColors {
+  vector<vector<int64_t>> forbidden_;
+  size_t num_colors_;
+
+ public:
+  explicit ForbiddenColors(const Graph &g) : forbidden_(MaxThreads()) {
+    int64_t max_degree = 0;
+    #pragma omp parallel for reduction(max : max_degree)
+    for (NodeID n=0; n < g.num_nodes(); n++)
+      max_degree = max(max_degree, g.out_degree(n));
+    num_colors_ = max_degree + 1;
+  }
+
+  vector<int64_t>& local() {
+    vector<int64_t> &forbidden = forbidden_[ThreadNum()];
+    if (forbidden.empty())
+      forbidden.assign(num_colors_, -1);
+    return forbidden;
+  }
+};
+
+
+pvector<NodeID> SpeculativeColor(const Graph &g,
+                                 bool logging_enabled = true) {
+  pvector<uint64_t> priority = Priorities(g);
+  pvector<NodeID> color(g.num_nodes(), kNoColor);
+  ForbiddenColors forbidden(g);
+  SlidingQueue<NodeID> queue_a(g.num_nodes());
+  SlidingQueue<NodeID> queue_b(g.num_nodes());
+  SlidingQueue<NodeID> *worklist = &queue_a;
+  SlidingQueue<NodeID> *conflicts = &queue_b;
+  // First worklist is ordered by decreasing log-degree
+  uint64_t max_log_degree = 0;
+  #pragma omp parallel for reduction(max : max_log_degree)
+  for (NodeID n=0; n < g.num_nodes(); n++)
+    max_log_degree = max(max_log_degree, priority[n] >> 32);
+  for (int64_t log_degree=max_log_degree; log_degree >= 0; log_degree--) {
+    #pragma omp parallel
+    {
+      QueueBuffer<NodeID> lworklist(*worklist);
+      #pragma omp for nowait
+      for (NodeID n=0; n < g.num_nodes(); n++) {
+        if (static_cast<int64_t>(priority[n] >> 32) == log_degree)
+          lworklist.push_back(n);
+      }
+      lworklist.flush();
+    }
+  }
+  worklist->slide_window();
+  int64_t num_rounds = 0;
+  while (!worklist->empty()) {
+    num_rounds++;
+    const int64_t round_stamp = num_rounds * g.num_nodes();
+    #pragma omp parallel
+    {
+      vector<int64_t> &lforbidden = forbidden.local();
+      #pragma omp for schedule(dynamic, 64)
+      for (auto it = worklist->begin(); it < worklist->end(); it++)
+        color[*it] = FirstFit(g, *it, color, lforbidden, round_stamp + *it);
+    }
+    #pragma omp parallel
+    {
+      QueueBuffer<NodeID> lconflicts(*conflicts);
+      #pragma omp for schedule(dynamic, 64) nowait
+      for (auto it = worklist->begin(); it < worklist->end(); it++) {
+        NodeID u = *it;
+        for (NodeID v : g.out_neigh(u)) {
+          if ((color[v] == color[u]) && Precedes(priority, v, u)) {
+            lconflicts.push_back(u);
+            break;
+          }
+        }
+      }
+      lconflicts.flush();
+    }
+    conflicts->slide_window();
+    worklist->reset();
+    swap(worklist, conflicts);
+  }
+  if (logging_enabled)
+    PrintStep("Rounds", num_rounds);
+  return color;
+}
+
+
+pvector<NodeID> JonesPlassmann(const Graph &g, bool logging_enabled = true) {
+  pvector<uint64_t> priority = Priorities(g);
+  pvector<NodeID> color(g.num_nodes(), kNoColor);
+  pvector<NodeID> num_waiting(g.num_nodes());
+  ForbiddenColors forbidden(g);
+  SlidingQueue<NodeID> frontier(g.num_nodes());
+  #pragma omp parallel
+  {
+    QueueBuffer<NodeID> lfrontier(frontier);
+    #pragma omp for schedule(dynamic, 64) nowait
+    for (NodeID u=0; u < g.num_nodes(); u++) {
+      num_waiting[u] = 0;
+      for (NodeID v : g.out_neigh(u))
+        num_waiting[u] += Precedes(priority, v, u);
+      if (num_waiting[u] == 0)
+        lfrontier.push_back(u);
+    }
+    lfrontier.flush();
+  }
+  frontier.slide_window();
+  int64_t num_rounds = 0;
+  while (!frontier.empty()) {
+    num_rounds++;
+    #pragma omp parallel
+    {
+      QueueBuffer<NodeID> lfrontier(frontier);
+      vector<int64_t> &lforbidden = forbidden.local();
+      #pragma omp for schedule(dynamic, 64) nowait
+      for (auto it = frontier.begin(); it < frontier.end(); it++) {
+        NodeID u = *it;
+        color[u] = FirstFit(g, u, color, lforbidden, u);
+        for (NodeID v : g.out_neigh(u)) {
+          if ((color[v] == kNoColor) &&
+              (fetch_and_add(num_waiting[v], -1) == 1))
+            lfrontier.push_back(v);
+        }
+      }
+      lfrontier.flush();
+    }
+    frontier.slide_window();
+  }
+  if (logging_enabled)
+    PrintStep("Rounds", num_rounds);
+  return color;
+}
+
+
+void PrintColorStats(const Graph &g, const pvector<NodeID> &color) {
+  NodeID max_color = -1;
+  for (NodeID n : g.vertices())
+    max_color = max(max_color, color[n]);
+  vector<int64_t> color_size(max_color + 1, 0);
+  for (NodeID n : g.vertices())
+    color_size[color[n]]++;
+  cout << max_color + 1 << " colors (biggest has "
+       << *max_element(color_size.begin(), color_size.end()) << " vertices)"
+       << endl;
+}
+
+
+// Every vertex has a color no higher than its degree (first fit) that none
+// of its neighbors has
+bool ColorVerifier(const Graph &g, const pvector<NodeID> &color) {
+  bool all_ok = true;
+  for (NodeID u : g.vertices()) {
+    if ((color[u] < 0) || (color[u] > g.out_degree(u))) {
+      cout << u << ": color " << color[u] << " out of range" << endl;
+      all_ok = false;
+    }
+    for (NodeID v : g.out_neigh(u)) {
+      if (color[v] == color[u]) {
+        cout << u << " & " << v << " both have color " << color[u] << endl;
+        all_ok = false;
+      }
+    }
+  }
+  return all_ok;
+}
+
+
+int main(int argc, char* argv[]) {
+  CLColor cli(argc, argv, "graph coloring");
+  if (!cli.ParseArgs())
+    return -1;
+  Builder b(cli);
+  Graph g = b.MakeGraph();
+  if (g.directed()) {
+    cout << "Input graph is directed but color requires undirected" << endl;
+    return -2;
+  }
+  if (cli.jones_plassmann()) {
+    auto JPBound = [] (const Graph &g) { return JonesPlassmann(g); };
+    BenchmarkKernel(cli, g, JPBound, PrintColorStats, ColorVerifier);
+  } else {
+    auto SpeculativeBound = [] (const Graph &g) {
+      return SpeculativeColor(g);
+    };
+    BenchmarkKernel(cli, g, SpeculativeBound, PrintColorStats, ColorVerifier);
+  }
+  return 0;
+}
@@ -193,26 +193,291 @@ class CLPageRank : public CLApp {
 template<typename WeightT_>
 class CLDelta : public CLApp {
   WeightT_ delta_ = 1;
+  bool auto_delta_ = false;
+  bool probe_delta_ = false;
+  bool use_multiqueue_ = false;
 
  public:
   CLDelta(int argc, char** argv, std::string name) : CLApp(argc, argv, name) {
-    get_args_ += "d:";
-    AddHelpLine('d', "d", "delta parameter", std::to_string(delta_));
+    get_args_ += "d:m";
+    AddHelpLine('d', "d", "delta parameter (\"auto\" or \"probe\" to pick)",
+                std::to_string(delta_));
+    AddHelpLine('m', "", "use MultiQueue instead of delta-stepping", "false");
   }
 
   void HandleArg(signed char opt, char* opt_arg) override {
     switch (opt) {
       case 'd':
-        if (std::is_floating_point<WeightT_>::value)
+        if (std::string(opt_arg) == "auto") {
+          auto_delta_ = true;
+        } else if (std::string(opt_arg) == "probe") {
+          auto_delta_ = true;
+          probe_delta_ = true;
+        } else if (std::is_floating_point<WeightT_>::value) {
           delta_ = static_cast<WeightT_>(atof(opt_arg));
-        else
+        } else {
           delta_ = static_cast<WeightT_>(atol(opt_arg));
+        }
         break;
+      case 'm': use_multiqueue_ = true;                 break;
       default: CLApp::HandleArg(opt, opt_arg);
     }
   }
 
   WeightT_ delta() const { return delta_; }
+  bool auto_delta() const { return auto_delta_; }
+  bool probe_delta() const { return probe_delta_; }
+  bool use_multiqueue() const { return use_multiqueue_; }
+};
+
+
+
+template<typename WeightT_>
+class CLALT : public CLDelta<WeightT_> {
+  int num_landmarks_ = 16;
+  int num_queries_ = 64;
+  std::string index_in_ = "";
+  std::string index_out_ = "";
+
+ public:
+  CLALT(int argc, char** argv, std::string name)
+      : CLDelta<WeightT_>(argc, argv, name) {
+    this->get_args_ += "l:q:i:o:";
+    this->AddHelpLine('l', "l", "number of landmarks",
+                      std::to_string(num_landmarks_));
+    this->AddHelpLine('q', "q", "number of random queries per trial",
+                      std::to_string(num_queries_));
+    this->AddHelpLine('i', "file", "load landmark index from file");
+    this->AddHelpLine('o', "file", "save landmark index to file");
+  }
+
+  void HandleArg(signed char opt, char* opt_arg) override {
+    switch (opt) {
+      case 'l': num_landmarks_ = atoi(opt_arg);                 break;
+      case 'q': num_queries_ = atoi(opt_arg);                   break;
+      case 'i': index_in_ = std::string(opt_arg);               break;
+      case 'o': index_out_ = std::string(opt_arg);              break;
+      default: CLDelta<WeightT_>::HandleArg(opt, opt_arg);
+    }
+  }
+
+  int num_landmarks() const { return num_landmarks_; }
+  int num_queries() const { return num_queries_; }
+  std::string index_in() const { return index_in_; }
+  std::string index_out() const { return index_out_; }
+};
+
+
+
+class CLPLL : public CLApp {
+  int num_bp_roots_ = 16;
+  int num_queries_ = 1024;
+  std::string query_file_ = "";
+  std::string index_in_ = "";
+  std::string index_out_ = "";
+
+ public:
+  CLPLL(int argc, char** argv, std::string name) : CLApp(argc, argv, name) {
+    get_args_ += "b:i:o:q:Q:";
+    AddHelpLine('b', "b", "number of bit-parallel roots",
+                std::to_string(num_bp_roots_));
+    AddHelpLine('i', "file", "load labels from file");
+    AddHelpLine('o', "file", "save labels to file");
+    AddHelpLine('q', "q", "number of random queries per trial",
+                std::to_string(num_queries_));
+    AddHelpLine('Q', "file", "answer queries (\"u v\" per line) from file");
+  }
+
+  void HandleArg(signed char opt, char* opt_arg) override {
+    switch (opt) {
+      case 'b': num_bp_roots_ = atoi(opt_arg);                  break;
+      case 'i': index_in_ = std::string(opt_arg);               break;
+      case 'o': index_out_ = std::string(opt_arg);              break;
+      case 'q': num_queries_ = atoi(opt_arg);                   break;
+      case 'Q': query_file_ = std::string(opt_arg);             break;
+      default: CLApp::HandleArg(opt, opt_arg);
+    }
+  }
+
+  int num_bp_roots() const { return num_bp_roots_; }
+  int num_queries() const { return num_queries_; }
+  std::string query_file() const { return query_file_; }
+  std::string index_in() const { return index_in_; }
+  std::string index_out() const { return index_out_; }
+};
+
+
+
+class CLTC : public CLApp {
+  double sample_rate_ = 1;
+
+ public:
+  CLTC(int argc, char** argv, std::string name) : CLApp(argc, argv, name) {
+    get_args_ += "p:";
+    AddHelpLine('p', "p", "estimate from edges sampled with probability p",
+                "1 (exact)");
+  }
+
+  void HandleArg(signed char opt, char* opt_arg) override {
+    switch (opt) {
+      case 'p': sample_rate_ = std::stod(opt_arg);              break;
+      default: CLApp::HandleArg(opt, opt_arg);
+    }
+  }
+
+  double sample_rate() const { return sample_rate_; }
+};
+
+
+
+class CLTruss : public CLApp {
+  std::string vertex_out_ = "";
+  std::string edge_out_ = "";
+
+ public:
+  CLTruss(int argc, char** argv, std::string name) : CLApp(argc, argv, name) {
+    get_args_ += "e:o:";
+    AddHelpLine('e', "file", "save truss number of each edge to file");
+    AddHelpLine('o', "file", "save triangles & LCC of each vertex to file");
+  }
+
+  void HandleArg(signed char opt, char* opt_arg) override {
+    switch (opt) {
+      case 'e': edge_out_ = std::string(opt_arg);               break;
+      case 'o': vertex_out_ = std::string(opt_arg);             break;
+      default: CLApp::HandleArg(opt, opt_arg);
+    }
+  }
+
+  std::string vertex_out() const { return vertex_out_; }
+  std::string edge_out() const { return edge_out_; }
+};
+
+
+
+class CLCC : public CLApp {
+  bool stream_el_ = false;
+
+ public:
+  CLCC(int argc, char** argv, std::string name) : CLApp(argc, argv, name) {
+    get_args_ += "e";
+    AddHelpLine('e', "", "union-find over edge list as read, without graph",
+                "false");
+  }
+
+  void HandleArg(signed char opt, char* opt_arg) override {
+    switch (opt) {
+      case 'e': stream_el_ = true;                     break;
+      default: CLApp::HandleArg(opt, opt_arg);
+    }
+  }
+
+  bool stream_el() const { return stream_el_; }
+};
+
+
+
+class CLColor : public CLApp {
+  bool jones_plassmann_ = false;
+
+ public:
+  CLColor(int argc, char** argv, std::string name) : CLApp(argc, argv, name) {
+    get_args_ += "j";
+    AddHelpLine('j', "", "Jones-Plassmann instead of speculative coloring",
+                "false");
+  }
+
+  void HandleArg(signed char opt, char* opt_arg) override {
+    switch (opt) {
+      case 'j': jones_plassmann_ = true;               break;
+      default: CLApp::HandleArg(opt, opt_arg);
+    }
+  }
+
+  bool jones_plassmann() const { return jones_plassmann_; }
+};
+
+
+
+class CLCommunity : public CLApp {
+  int max_iters_;
+  bool label_propagation_ = false;
+
+ public:
+  CLCommunity(int argc, char** argv, std::string name, int max_iters) :
+    CLApp(argc, argv, name), max_iters_(max_iters) {
+    get_args_ += "i:l";
+    AddHelpLine('i', "i", "perform at most i iterations (per level)",
+                std::to_string(max_iters_));
+    AddHelpLine('l', "", "label propagation instead of Louvain", "false");
+  }
+
+  void HandleArg(signed char opt, char* opt_arg) override {
+    switch (opt) {
+      case 'i': max_iters_ = atoi(opt_arg);            break;
+      case 'l': label_propagation_ = true;             break;
+      default: CLApp::HandleArg(opt, opt_arg);
+    }
+  }
+
+  int max_iters() const { return max_iters_; }
+  bool label_propagation() const { return label_propagation_; }
+};
+
+
+
+class CLUpdate : public CLApp {
+  int64_t batch_size_ = 1024;
+  int delete_percent_ = 50;
+
+ public:
+  CLUpdate(int argc, char** argv, std::string name)
+      : CLApp(argc, argv, name) {
+    get_args_ += "b:p:";
+    AddHelpLine('b', "b", "edge updates per batch",
+                std::to_string(batch_size_));
+    AddHelpLine('p', "p", "percent of updates that are deletions",
+                std::to_string(delete_percent_));
+  }
+
+  void HandleArg(signed char opt, char* opt_arg) override {
+    switch (opt) {
+      case 'b': batch_size_ = atol(opt_arg);                    break;
+      case 'p': delete_percent_ = atoi(opt_arg);                break;
+      default: CLApp::HandleArg(opt, opt_arg);
+    }
+  }
+
+  int64_t batch_size() const { return batch_size_; }
+  int delete_percent() const { return delete_percent_; }
+};
+
+
+
+class CLPageRankUpdate : public CLUpdate {
+  int max_iters_;
+  double tolerance_;
+
+ public:
+  CLPageRankUpdate(int argc, char** argv, std::string name, double tolerance,
+                   int max_iters) :
+    CLUpdate(argc, argv, name), max_iters_(max_iters), tolerance_(tolerance) {
+    get_args_ += "i:t:";
+    AddHelpLine('i', "i", "perform at most i iterations",
+                std::to_string(max_iters_));
+    AddHelpLine('t', "t", "use tolerance t", std::to_string(tolerance_));
+  }
+
+  void HandleArg(signed char opt, char* opt_arg) override {
+    switch (opt) {
+      case 'i': max_iters_ = atoi(opt_arg);            break;
+      case 't': tolerance_ = std::stod(opt_arg);            break;
+      default: CLUpdate::HandleArg(opt, opt_arg);
+    }
+  }
+
+  int max_iters() const { return max_iters_; }
+  double tolerance() const { return tolerance_; }
 };
 
 
@@ -0,0 +1,514 @@
+// Copyright (c) 2015, The Regents of the University of California (Regents)
+// See LICENSE.txt for license details
+
+#include <algorithm>
+#include <cinttypes>
+#include <iostream>
+#include <unordered_map>
+#include <vector>
+
+#include "benchmark.h"
+#include "builder.h"
+#include "command_line.h"
+#include "graph.h"
+#include "platform_atomics.h"
+#include "pvector.h"
+#include "timer.h"
+
+
+/*
+GAP Benchmark Suite
+Kernel: Community Detection (community)
+
+Will return the community of every vertex, chosen to give the partition a
+high modularity: the fraction of the edges that are within communities, minus
+the fraction expected if the edges were placed at random (keeping degrees)
+
+Requires input graph:
+  - to be undirected
+  - no duplicate edges
+
+By default, this runs the Louvain method [1] in parallel as in Grappolo [2].
+Each level moves vertices (all in parallel, reading the current assignment)
+to the neighboring community that most increases modularity, until a pass
+over all vertices increases it by less than kMinGain. The communities then
+become the vertices of a coarser weighted graph (built with a prefix sum and
+GenIndex like the builder), in which the weight of an edge is the number of
+original edges between the two communities, and the original edges within a
+community are kept as a self weight instead of self loops. Levels continue
+until one moves no vertex. So that two vertices alone in their communities
+do not swap places forever, such a vertex only joins another lone vertex with
+a lower ID [2].
+
+With -l, it instead runs label propagation [3]: in each iteration every
+vertex (in parallel, in place) takes the label most common among its
+neighbors, keeping its own on a tie with it and otherwise taking the lowest.
+It stops once no label changes.
+
+With -i, both stop after that many passes (per level) or iterations even if
+they have not converged. The verifier checks the property each one converges
+to: for Louvain that no community increases modularity by joining one of its
+neighbors, and for label propagation that every label is as common as any
+among the neighbors.
+
+[1] Vincent D. Blondel, Jean-Loup Guillaume, Renaud Lambiotte, and Etienne
+    Lefebvre. "Fast unfolding of communities in large networks." Journal of
+    Statistical Mechanics: Theory and Experiment, 2008.
+
+[2] Hao Lu, Mahantesh Halappanavar, and Ananth Kalyanaraman. "Parallel
+    heuristics for scalable community detection." Parallel Computing, 2015.
+
+[3] Usha Nandini Raghavan, Reka Albert, and Soundar Kumara. "Near linear time
+    algorithm to detect community structures in large-scale networks."
+    Physical Review E, 2007.
+*/
+
+
+using namespace std;
+
+const double kMinGain = 1e-6;
+
+// Coarse graphs keep 64-bit weights, since an edge between two communities
+// sums the weights of all the edges between their members
+typedef NodeWeight<NodeID, int64_t> CNode;
+typedef CSRGraph<NodeID, CNode> CGraph;
+
+
+inline NodeID EdgeTarget(NodeID v) { return v; }
+inline NodeID EdgeTarget(const CNode &cn) { return cn.v; }
+inline int64_t EdgeWeight(NodeID) { return 1; }
+inline int64_t EdgeWeight(const CNode &cn) { return cn.w; }
+
+
+// Per-thread scratch for SumByCommunity: weight_to has room for every vertex
+// of the input graph (so also for the communities of any level), and is only
+// allocated by a thread's first use and then reused for every pass, level, and
+// iteration, as callers reset just the entries listed in touched
+class CommunityScratch {
+ public:
+  struct Local {
+    vector<int64_t> weight_to;
+    vector<NodeID> touched;
+  };
+
+  explicit CommunityScratch(NodeID num_nodes) :
+    local_(MaxThreads()), num_nodes_(num_nodes) {}
+
+  Local& local() {
+    Local &scratch = local_[ThreadNum()];
+    if (scratch.weight_to.empty())
+      scratch.weight_to.assign(num_nodes_, -1);
+    return scratch;
+  }
+
+ private:
+  vector<Local> local_;
+  NodeID num_nodes_;
+};
+
+
+// Adds the weight of each edge of u to weight_to of the community of its
+// other endpoint, listing each community the first time it is reached in
+// touched (weight_to is -1 for communities not yet reached)
+template <typename GraphT_>
+void SumByCommunity(const GraphT_ &g, NodeID u, const pvector<NodeID> &comm,
+                    vector<int64_t> &weight_to, vector<NodeID> &touched) {
+  for (auto wn : g.out_neigh(u)) {
+    NodeID c = comm[EdgeTarget(wn)];
+    if (weight_to[c] < 0) {
+      weight_to[c] = 0;
+      touched.push_back(c);
+    }
+    weight_to[c] += EdgeWeight(wn);
+  }
+}
+
+
+// Total weight of the edges of each vertex, including its self weight
+template <typename GraphT_>
+pvector<int64_t> Strengths(const GraphT_ &g, const pvector<int64_t> &self) {
+  pvector<int64_t> strength(g.num_nodes());
+  #pragma omp parallel for
+  for (NodeID u=0; u < g.num_nodes(); u++) {
+    strength[u] = self[u];
+    for (auto wn : g.out_neigh(u))
+      strength[u] += EdgeWeight(wn);
+  }
+  return strength;
+}
+
+
+// One level of Louvain: moves vertices until a pass gains less than kMinGain
+// (or max_passes), leaving the community of each vertex in comm. Moving u
+// from its community (without u) to c changes modularity by
+//   2 / total * (weight from u to c - strength of u * strength of c / total)
+// so only the part in parentheses is compared. Returns the number of moves.
+template <typename GraphT_>
+int64_t MoveVertices(const GraphT_ &g, const pvector<int64_t> &self,
+                     double total_weight, int max_passes,
+                     CommunityScratch &scratch, pvector<NodeID> &comm) {
+  pvector<int64_t> strength = Strengths(g, self);
+  pvector<int64_t> comm_strength(g.num_nodes());
+  pvector<NodeID> comm_size(g.num_nodes());
+  #pragma omp parallel for
+  for (NodeID u=0; u < g.num_nodes(); u++) {
+    comm[u] = u;
+    comm_strength[u] = strength[u];
+    comm_size[u] = 1;
+  }
+  int64_t total_moves = 0;
+  for (int pass=0; pass < max_passes; pass++) {
+    int64_t num_moves = 0;
+    double gain = 0;
+    #pragma omp parallel reduction(+ : num_moves, gain)
+    {
+      vector<int64_t> &weight_to = scratch.local().weight_to;
+      vector<NodeID> &touched = scratch.local().touched;
+      #pragma omp for schedule(dynamic, 64)
+      for (NodeID u=0; u < g.num_nodes(); u++) {
+        NodeID old_c = comm[u];
+        weight_to[old_c] = 0;
+        touched.push_back(old_c);
+        SumByCommunity(g, u, comm, weight_to, touched);
+        double scale = strength[u] / total_weight;
+        double stay = weight_to[old_c] -
+                      (comm_strength[old_c] - strength[u]) * scale;
+        NodeID best_c = old_c;
+        double best = stay;
+        for (NodeID c : touched) {
+          double join = weight_to[c] - comm_strength[c] * scale;
+          if ((c != old_c) && ((join > best) ||
+              ((join == best) && (best_c != old_c) && (c < best_c)))) {
+            best_c = c;
+            best = join;
+          }
+          weight_to[c] = -1;
+        }
+        touched.clear();
+        if ((best_c == old_c) ||
+            ((comm_size[old_c] == 1) && (comm_size[best_c] == 1) &&
+             (best_c > old_c)))
+          continue;
+        fetch_and_add(comm_strength[old_c], -strength[u]);
+        fetch_and_add(comm_strength[best_c], strength[u]);
+        fetch_and_add(comm_size[old_c], -1);
+        fetch_and_add(comm_size[best_c], 1);
+        comm[u] = best_c;
+        num_moves++;
+        gain += best - stay;
+      }
+    }
+    total_moves += num_moves;
+    if (2 * gain / total_weight < kMinGain)
+      break;
+  }
+  return total_moves;
+}
+
+
+// Renumbers the communities in comm to [0, number of communities), keeping
+// their order, and returns how many there are
+NodeID Renumber(pvector<NodeID> &comm) {
+  pvector<NodeID> used(comm.size(), 0);
+  #pragma omp parallel for
+  for (size_t u=0; u < comm.size(); u++)
+    used[comm[u]] = 1;
+  pvector<SGOffset> new_ids = Builder::ParallelPrefixSum(used);
+  #pragma omp parallel for
+  for (size_t u=0; u < comm.size(); u++)
+    comm[u] = new_ids[comm[u]];
+  return new_ids[comm.size()];
+}
+
+
+// Graph with a vertex for each community, whose edges sum the weights of the
+// edges between them. Fills coarse_self with the self weight of each
+// community (including the weight of the edges within it).
+template <typename GraphT_>
+CGraph Coarsen(const GraphT_ &g, const pvector<int64_t> &self,
+               const pvector<NodeID> &comm, NodeID num_comms,
+               CommunityScratch &scratch, pvector<int64_t> &coarse_self) {
+  pvector<NodeID> comm_size(num_comms, 0);
+  #pragma omp parallel for
+  for (NodeID u=0; u < g.num_nodes(); u++)
+    fetch_and_add(comm_size[comm[u]], 1);
+  pvector<SGOffset> member_offsets = Builder::ParallelPrefixSum(comm_size);
+  pvector<SGOffset> member_tails(member_offsets.begin(), member_offsets.end());
+  pvector<NodeID> members(g.num_nodes());
+  #pragma omp parallel for
+  for (NodeID u=0; u < g.num_nodes(); u++)
+    members[fetch_and_add(member_tails[comm[u]], 1)] = u;
+  pvector<NodeID> degrees(num_comms);
+  #pragma omp parallel
+  {
+    vector<int64_t> &weight_to = scratch.local().weight_to;
+    vector<NodeID> &touched = scratch.local().touched;
+    #pragma omp for schedule(dynamic, 64)
+    for (NodeID c=0; c < num_comms; c++) {
+      coarse_self[c] = 0;
+      for (SGOffset i=member_offsets[c]; i < member_offsets[c+1]; i++) {
+        coarse_self[c] += self[members[i]];
+        SumByCommunity(g, members[i], comm, weight_to, touched);
+      }
+      degrees[c] = touched.size();
+      for (NodeID d : touched) {
+        if (d == c) {
+          coarse_self[c] += weight_to[d];
+          degrees[c]--;
+        }
+        weight_to[d] = -1;
+      }
+      touched.clear();
+    }
+  }
+  pvector<SGOffset> offsets = Builder::ParallelPrefixSum(degrees);
+  CNode* neighs = new CNode[offsets[num_comms]];
+  CNode** index = CGraph::GenIndex(offsets, neighs);
+  #pragma omp parallel
+  {
+    vector<int64_t> &weight_to = scratch.local().weight_to;
+    vector<NodeID> &touched = scratch.local().touched;
+    #pragma omp for schedule(dynamic, 64)
+    for (NodeID c=0; c < num_comms; c++) {
+      for (SGOffset i=member_offsets[c]; i < member_offsets[c+1]; i++)
+        SumByCommunity(g, members[i], comm, weight_to, touched);
+      CNode *out = index[c];
+      for (NodeID d : touched) {
+        if (d != c)
+          *out++ = CNode(d, weight_to[d]);
+        weight_to[d] = -1;
+      }
+      touched.clear();
+      sort(index[c], index[c+1]);
+    }
+  }
+  return CGraph(num_comms, index, neighs);
+}
+
+
+// Runs a level of Louvain on g, relabels membership (the community of each
+// original vertex) with the communities found, and if some vertex moved,
+// replaces coarse & self with the next level
+template <typename GraphT_>
+bool LouvainLevel(const GraphT_ &g, double total_weight, int max_passes,
+                  int level, pvector<NodeID> &membership,
+                  CommunityScratch &scratch, pvector<int64_t> &self,
+                  CGraph &coarse, bool logging_enabled) {
+  Timer t;
+  t.Start();
+  pvector<NodeID> comm(g.num_nodes());
+  int64_t num_moves = MoveVertices(g, self, total_weight, max_passes, scratch,
+                                   comm);
+  NodeID num_comms = Renumber(comm);
+  #pragma omp parallel for
+  for (size_t v=0; v < membership.size(); v++)
+    membership[v] = comm[membership[v]];
+  if (num_moves != 0) {
+    pvector<int64_t> coarse_self(num_comms);
+    coarse = Coarsen(g, self, comm, num_comms, scratch, coarse_self);
+    self.swap(coarse_self);
+  }
+  t.Stop();
+  if (logging_enabled)
+    PrintStep(level, t.Seconds(), num_comms);
+  return num_moves != 0;
+}
+
+
+pvector<NodeID> Louvain(const Graph &g, int max_passes,
+                        bool logging_enabled = true) {
+  pvector<NodeID> membership(g.num_nodes());
+  #pragma omp parallel for
+  for (NodeID v=0; v < g.num_nodes(); v++)
+    membership[v] = v;
+  pvector<int64_t> self(g.num_nodes(), 0);
+  const double total_weight = g.num_edges_directed();
+  CommunityScratch scratch(g.num_nodes());
+  CGraph coarse;
+  bool moved = LouvainLevel(g, total_weight, max_passes, 0, membership,
+                            scratch, self, coarse, logging_enabled);
+  for (int level=1; moved; level++) {
+    CGraph next;
+    moved = LouvainLevel(coarse, total_weight, max_passes, level, membership,
+                         scratch, self, next, logging_enabled);
+    coarse = std::move(next);
+  }
+  return membership;
+}
+
+
+pvector<NodeID> LabelPropagation(const Graph &g, int max_iters,
+                                 bool logging_enabled = true) {
+  pvector<NodeID> label(g.num_nodes());
+  #pragma omp parallel for
+  for (NodeID v=0; v < g.num_nodes(); v++)
+    label[v] = v;
+  CommunityScratch scratch(g.num_nodes());
+  Timer t;
+  for (int iter=0; iter < max_iters; iter++) {
+    t.Start();
+    int64_t num_changed = 0;
+    #pragma omp parallel reduction(+ : num_changed)
+    {
+      vector<int64_t> &count = scratch.local().weight_to;
+      vector<NodeID> &touched = scratch.local().touched;
+      #pragma omp for schedule(dynamic, 64)
+      for (NodeID u=0; u < g.num_nodes(); u++) {
+        SumByCommunity(g, u, label, count, touched);
+        NodeID old_label = label[u];
+        NodeID best_label = old_label;
+        int64_t best = count[old_label];
+        for (NodeID l : touched) {
+          if ((count[l] > best) || ((count[l] == best) &&
+              (best_label != old_label) && (l < best_label))) {
+            best_label = l;
+            best = count[l];
+          }
+          count[l] = -1;
+        }
+        touched.clear();
+        if (best_label != old_label) {
+          label[u] = best_label;
+          num_changed++;
+        }
+      }
+    }
+    t.Stop();
+    if (logging_enabled)
+      PrintStep(iter, t.Seconds(), num_changed);
+    if (num_changed == 0)
+      break;
+  }
+  return label;
+}
+
+
+double Modularity(const Graph &g, const pvector<NodeID> &comm) {
+  pvector<int64_t> comm_strength(g.num_nodes(), 0);
+  int64_t internal = 0;
+  #pragma omp parallel for reduction(+ : internal)
+  for (NodeID u=0; u < g.num_nodes(); u++) {
+    for (NodeID v : g.out_neigh(u))
+      internal += comm[u] == comm[v];
+    fetch_and_add(comm_strength[comm[u]], g.out_degree(u));
+  }
+  const double total_weight = g.num_edges_directed();
+  double expected = 0;
+  #pragma omp parallel for reduction(+ : expected)
+  for (NodeID c=0; c < g.num_nodes(); c++)
+    expected += (comm_strength[c] / total_weight) *
+                (comm_strength[c] / total_weight);
+  return internal / total_weight - expected;
+}
+
+
+void PrintCommunityStats(const Graph &g, const pvector<NodeID> &comm) {
+  vector<int64_t> comm_size(g.num_nodes(), 0);
+  for (NodeID n : g.vertices())
+    comm_size[comm[n]]++;
+  int64_t num_comms = 0;
+  int64_t biggest = 0;
+  for (int64_t size : comm_size) {
+    num_comms += size != 0;
+    biggest = max(biggest, size);
+  }
+  cout << num_comms << " communities (biggest has " << biggest
+       << " vertices)" << endl;
+  cout << "modularity: " << Modularity(g, comm) << endl;
+}
+
+
+// Weight of the edges between each pair of communities (within one, with
+// c == d) and the strength of each community, computed serially
+void CommunityEdges(const Graph &g, const pvector<NodeID> &comm,
+                    vector<unordered_map<NodeID, int64_t>> &weight_between,
+                    vector<int64_t> &comm_strength) {
+  weight_between.assign(g.num_nodes(), unordered_map<NodeID, int64_t>());
+  comm_strength.assign(g.num_nodes(), 0);
+  for (NodeID u : g.vertices()) {
+    comm_strength[comm[u]] += g.out_degree(u);
+    for (NodeID v : g.out_neigh(u))
+      weight_between[comm[u]][comm[v]]++;
+  }
+}
+
+
+// No community could increase modularity by joining a neighboring one
+bool LouvainVerifier(const Graph &g, const pvector<NodeID> &comm) {
+  for (NodeID n : g.vertices()) {
+    if ((comm[n] < 0) || (comm[n] >= g.num_nodes())) {
+      cout << n << ": community " << comm[n] << " out of range" << endl;
+      return false;
+    }
+  }
+  vector<unordered_map<NodeID, int64_t>> weight_between;
+  vector<int64_t> comm_strength;
+  CommunityEdges(g, comm, weight_between, comm_strength);
+  const double total_weight = g.num_edges_directed();
+  const double kTolerance = 1e-6;
+  bool all_ok = true;
+  for (NodeID c=0; c < g.num_nodes(); c++) {
+    for (auto &d_weight : weight_between[c]) {
+      NodeID d = d_weight.first;
+      double join = d_weight.second -
+                    comm_strength[c] * (comm_strength[d] / total_weight);
+      if ((d != c) && (join > kTolerance)) {
+        cout << "communities " << c << " & " << d << " should merge" << endl;
+        all_ok = false;
+      }
+    }
+  }
+  return all_ok;
+}
+
+
+// Every vertex has a label at least as common among its neighbors as any
+bool LabelVerifier(const Graph &g, const pvector<NodeID> &label) {
+  bool all_ok = true;
+  for (NodeID u : g.vertices()) {
+    if ((label[u] < 0) || (label[u] >= g.num_nodes())) {
+      cout << u << ": label " << label[u] << " out of range" << endl;
+      return false;
+    }
+    if (g.out_degree(u) == 0)
+      continue;
+    unordered_map<NodeID, int64_t> count;
+    for (NodeID v : g.out_neigh(u))
+      count[label[v]]++;
+    int64_t most = 0;
+    for (auto &label_count : count)
+      most = max(most, label_count.second);
+    if (count[label[u]] != most) {
+      cout << u << ": label " << label[u] << " not most common" << endl;
+      all_ok = false;
+    }
+  }
+  return all_ok;
+}
+
+
+int main(int argc, char* argv[]) {
+  CLCommunity cli(argc, argv, "community detection", 20);
+  if (!cli.ParseArgs())
+    return -1;
+  Builder b(cli);
+  Graph g = b.MakeGraph();
+  if (g.directed()) {
+    cout << "Input graph is directed but community requires undirected"
+         << endl;
+    return -2;
+  }
+  if (cli.label_propagation()) {
+    auto LPBound = [&cli] (const Graph &g) {
+      return LabelPropagation(g, cli.max_iters());
+    };
+    BenchmarkKernel(cli, g, LPBound, PrintCommunityStats, LabelVerifier);
+  } else {
+    auto LouvainBound = [&cli] (const Graph &g) {
+      return Louvain(g, cli.max_iters());
+    };
+    BenchmarkKernel(cli, g, LouvainBound, PrintCommunityStats,
+                    LouvainVerifier);
+  }
+  return 0;
+}
@@ -0,0 +1,427 @@
+// Copyright (c) 2015, The Regents of the University of California (Regents)
+// See LICENSE.txt for license details
+
+#ifndef DYNAMIC_GRAPH_H_
+#define DYNAMIC_GRAPH_H_
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstddef>
+#include <iostream>
+#include <type_traits>
+#include <vector>
+
+#include "graph.h"
+#include "pvector.h"
+#include "timer.h"
+#include "util.h"
+
+
+/*
+GAP Benchmark Suite
+Class:  DynamicGraph
+
+Graph container that takes batches of edge insertions and deletions
+ - Same accessors as CSRGraph (out_neigh, in_neigh, out_degree, ...), so code
+   templated on the graph type (e.g. EdgeBalancer, RepairPaths) runs on it
+ - Each neighborhood is still contiguous, but sits in a slot with room to
+   grow (a quarter of its degree plus a few), so most insertions are appended
+   in place. A vertex that outgrows its slot moves to its own allocation with
+   double the room.
+ - ApplyBatch has the same semantics as Builder::ApplyUpdates: both directions
+   of each update if undirected, deleting an edge removes every copy of it,
+   and no self-loops or redundant edges are inserted
+ - Updates are grouped by vertex, and each vertex is then updated by a single
+   thread with one pass over its neighborhood
+ - Neighborhoods are not kept sorted, Compact() returns an equivalent CSRGraph
+   (sorted like one from the Builder) for kernels that need one
+ - Slots left behind by vertices that moved, and room freed by deletions, are
+   reclaimed by ApplyBatch, which repacks a direction into fresh slots once it
+   holds over kRepackRatio times the space a fresh load would take
+*/
+
+
+template <class NodeID_, class DestID_ = NodeID_, bool MakeInverse = true>
+class DynamicGraph {
+  typedef EdgePair<NodeID_, DestID_> Edge;
+  typedef CSRGraph<NodeID_, DestID_, MakeInverse> CSRGraphT;
+  // Used for *non-negative* offsets within a neighborhood
+  typedef std::make_unsigned<std::ptrdiff_t>::type OffsetT;
+
+  static const NodeID_ kMinSlack = 4;
+  static const NodeID_ kSlackDivisor = 4;
+  static const int64_t kRepackRatio = 2;
+
+  // Used to access neighbors of vertex, basically sugar for iterators
+  class Neighborhood {
+    DestID_ *begin_;
+    DestID_ *end_;
+   public:
+    Neighborhood(DestID_ *begin, DestID_ *end, OffsetT start_offset)
+        : begin_(begin + std::min(start_offset, OffsetT(end - begin))),
+          end_(end) {}
+    typedef DestID_* iterator;
+    iterator begin() { return begin_; }
+    iterator end()   { return end_; }
+  };
+
+  // An update oriented for the neighborhoods of one direction
+  struct Update {
+    NodeID_ u;
+    DestID_ v;
+    bool insert;
+    NodeID_ target() const {
+      DestID_ dest = v;
+      return static_cast<NodeID_>(dest);
+    }
+    // by vertex, then deletions before insertions, then by target (and by
+    // weight, so the lightest of repeated insertions comes first)
+    bool operator< (const Update &rhs) const {
+      if (u != rhs.u)
+        return u < rhs.u;
+      if (insert != rhs.insert)
+        return !insert;
+      return v < rhs.v;
+    }
+  };
+
+  // Neighborhoods in one direction, vertices still in their slot in packed
+  // share it, the others own their storage
+  struct Adjacency {
+    pvector<DestID_*> starts;
+    pvector<NodeID_> degrees;
+    pvector<NodeID_> capacities;
+    DestID_ *packed_start = nullptr;
+    DestID_ *packed_end = nullptr;
+    int64_t allocated = 0;  // packed plus every vertex's own storage
+
+    void Swap(Adjacency &other) {
+      starts.swap(other.starts);
+      degrees.swap(other.degrees);
+      capacities.swap(other.capacities);
+      std::swap(packed_start, other.packed_start);
+      std::swap(packed_end, other.packed_end);
+      std::swap(allocated, other.allocated);
+    }
+
+    bool OwnsSlot(NodeID_ n) const {
+      return (starts[n] < packed_start) || (starts[n] >= packed_end);
+    }
+
+    void Release() {
+      for (size_t n=0; n < starts.size(); n++) {
+        if (OwnsSlot(n))
+          delete[] starts[n];
+      }
+      delete[] packed_start;
+      packed_start = packed_end = nullptr;
+    }
+  };
+
+  bool directed_;
+  int64_t num_nodes_;
+  int64_t num_edges_;
+  Adjacency out_;
+  Adjacency in_;
+
+  template <typename NeighFunc>
+  static void Load(int64_t num_nodes, NeighFunc neigh, Adjacency &adj) {
+    adj.starts = pvector<DestID_*>(num_nodes);
+    adj.degrees = pvector<NodeID_>(num_nodes);
+    adj.capacities = pvector<NodeID_>(num_nodes);
+    #pragma omp parallel for
+    for (NodeID_ n=0; n < num_nodes; n++) {
+      adj.degrees[n] = neigh(n).end() - neigh(n).begin();
+      adj.capacities[n] = adj.degrees[n] + adj.degrees[n] / kSlackDivisor +
+                          kMinSlack;
+    }
+    SGOffset total = 0;
+    pvector<SGOffset> offsets(num_nodes);
+    for (NodeID_ n=0; n < num_nodes; n++) {
+      offsets[n] = total;
+      total += adj.capacities[n];
+    }
+    adj.packed_start = new DestID_[total];
+    adj.packed_end = adj.packed_start + total;
+    adj.allocated = total;
+    #pragma omp parallel for
+    for (NodeID_ n=0; n < num_nodes; n++) {
+      adj.starts[n] = adj.packed_start + offsets[n];
+      std::copy(neigh(n).begin(), neigh(n).end(), adj.starts[n]);
+    }
+  }
+
+  // Orients updates for out (or in if transpose) neighborhoods, sorted
+  pvector<Update> OrientUpdates(const pvector<Edge> &insertions,
+                                const pvector<Edge> &deletions,
+                                bool transpose) const {
+    const int64_t copies = directed_ ? 1 : 2;
+    pvector<Update> updates((insertions.size() + deletions.size()) * copies);
+    int64_t num_updates = 0;
+    auto Orient = [&](Edge e, bool insert) {
+      if (!transpose)
+        updates[num_updates++] = Update{e.u, e.v, insert};
+      if (transpose || !directed_)
+        updates[num_updates++] = Update{static_cast<NodeID_>(e.v),
+                                        ReverseOf(e), insert};
+    };
+    for (Edge e : deletions)
+      Orient(e, false);
+    for (Edge e : insertions)
+      Orient(e, true);
+    std::sort(updates.begin(), updates.end());
+    return updates;
+  }
+
+  // Destination for reverse of e (same as Builder::GetSource)
+  static NodeID_ ReverseOf(EdgePair<NodeID_, NodeID_> e) {
+    return e.u;
+  }
+
+  template <typename WeightT_>
+  static NodeWeight<NodeID_, WeightT_> ReverseOf(
+      EdgePair<NodeID_, NodeWeight<NodeID_, WeightT_>> e) {
+    return NodeWeight<NodeID_, WeightT_>(e.u, e.v.w);
+  }
+
+  // Moves neighborhood of n to its own slot with room for at least capacity,
+  // returns how much more storage the adjacency now holds
+  static int64_t Grow(NodeID_ n, NodeID_ capacity, Adjacency &adj) {
+    NodeID_ new_capacity = std::max(capacity, 2 * adj.capacities[n]);
+    DestID_ *fresh = new DestID_[new_capacity];
+    std::copy(adj.starts[n], adj.starts[n] + adj.degrees[n], fresh);
+    int64_t added = new_capacity;
+    if (adj.OwnsSlot(n)) {
+      delete[] adj.starts[n];
+      added -= adj.capacities[n];
+    }
+    adj.starts[n] = fresh;
+    adj.capacities[n] = new_capacity;
+    return added;
+  }
+
+  // Applies [first, last), the sorted updates for vertex n, returns change in
+  // degree and adds any growth in storage to allocated. present is scratch.
+  static int64_t UpdateVertex(NodeID_ n, const Update *first,
+                              const Update *last, std::vector<bool> &present,
+                              Adjacency &adj, int64_t &allocated) {
+    const Update *ins_first = first;
+    while ((ins_first < last) && !ins_first->insert)
+      ins_first++;
+    auto ByTarget = [](const Update &up, NodeID_ t) {
+      return up.target() < t;
+    };
+    present.assign(last - ins_first, false);
+    // one bit per target modulo 64, so most neighbors skip both searches
+    uint64_t filter = 0;
+    for (const Update *up = first; up < last; up++)
+      filter |= static_cast<uint64_t>(1) << (up->target() & 63);
+    DestID_ *neighs = adj.starts[n];
+    NodeID_ old_degree = adj.degrees[n];
+    NodeID_ degree = old_degree;
+    for (NodeID_ i=0; i < degree; ) {
+      NodeID_ t = static_cast<NodeID_>(neighs[i]);
+      if (((filter >> (t & 63)) & 1) == 0) {
+        i++;
+        continue;
+      }
+      const Update *del = std::lower_bound(first, ins_first, t, ByTarget);
+      if ((del < ins_first) && (del->target() == t)) {
+        neighs[i] = neighs[--degree];
+        continue;
+      }
+      const Update *ins = std::lower_bound(ins_first, last, t, ByTarget);
+      if ((ins < last) && (ins->target() == t)) {
+        present[ins - ins_first] = true;
+        // like SquishCSR, an inserted copy replaces a heavier existing edge
+        if (ins->v < neighs[i])
+          neighs[i] = ins->v;
+      }
+      i++;
+    }
+    NodeID_ num_new = 0;
+    for (const Update *ins = ins_first; ins < last; ins++) {
+      bool repeat = (ins > ins_first) && (ins->target() == (ins-1)->target());
+      present[ins - ins_first] = present[ins - ins_first] || repeat ||
+                                 (ins->target() == n);
+      if (!present[ins - ins_first])
+        num_new++;
+    }
+    adj.degrees[n] = degree;
+    if (degree + num_new > adj.capacities[n])
+      allocated += Grow(n, degree + num_new, adj);
+    neighs = adj.starts[n];
+    for (const Update *ins = ins_first; ins < last; ins++) {
+      if (!present[ins - ins_first])
+        neighs[degree++] = ins->v;
+    }
+    adj.degrees[n] = degree;
+    return static_cast<int64_t>(degree) - old_degree;
+  }
+
+  static int64_t ApplyToAdjacency(const pvector<Update> &updates,
+                                  Adjacency &adj) {
+    // start of each vertex's run of updates
+    std::vector<int64_t> run_starts;
+    for (size_t i=0; i < updates.size(); i++) {
+      if ((i == 0) || (updates[i].u != updates[i-1].u))
+        run_starts.push_back(i);
+    }
+    run_starts.push_back(updates.size());
+    const int64_t num_runs = run_starts.size() - 1;
+    const Update *base = updates.begin();
+    int64_t degree_change = 0;
+    int64_t allocated = 0;
+    #pragma omp parallel reduction(+ : degree_change, allocated)
+    {
+      std::vector<bool> present;
+      #pragma omp for schedule(dynamic, 64)
+      for (int64_t r=0; r < num_runs; r++) {
+        const Update *first = base + run_starts[r];
+        degree_change += UpdateVertex(first->u, first, base + run_starts[r+1],
+                                      present, adj, allocated);
+      }
+    }
+    adj.allocated += allocated;
+    return degree_change;
+  }
+
+  // Reloads adj into fresh slots if it holds over kRepackRatio times the
+  // space that would take (num_neighs in total), returns if it did
+  bool MaybeRepack(int64_t num_neighs, Adjacency &adj) const {
+    int64_t fresh_size = num_neighs + num_neighs / kSlackDivisor +
+                         num_nodes_ * kMinSlack;
+    if (adj.allocated <= kRepackRatio * fresh_size)
+      return false;
+    Adjacency fresh;
+    Load(num_nodes_, [&adj](NodeID_ n) {
+      return Neighborhood(adj.starts[n], adj.starts[n] + adj.degrees[n], 0);
+    }, fresh);
+    adj.Swap(fresh);
+    fresh.Release();
+    return true;
+  }
+
+  template <typename NeighFunc>
+  static void Pack(int64_t num_nodes, NeighFunc neigh,
+                   DestID_*** index, DestID_** neighs) {
+    pvector<SGOffset> offsets(num_nodes + 1);
+    offsets[0] = 0;
+    for (NodeID_ n=0; n < num_nodes; n++)
+      offsets[n+1] = offsets[n] + (neigh(n).end() - neigh(n).begin());
+    *neighs = new DestID_[offsets[num_nodes]];
+    *index = CSRGraphT::GenIndex(offsets, *neighs);
+    #pragma omp parallel for schedule(dynamic, 1024)
+    for (NodeID_ n=0; n < num_nodes; n++) {
+      std::copy(neigh(n).begin(), neigh(n).end(), (*index)[n]);
+      std::sort((*index)[n], (*index)[n+1]);
+    }
+  }
+
+ public:
+  explicit DynamicGraph(const CSRGraphT &g)
+      : directed_(g.directed()), num_nodes_(g.num_nodes()),
+        num_edges_(g.num_edges()) {
+    Load(num_nodes_, [&g](NodeID_ n) { return g.out_neigh(n); }, out_);
+    if (directed_ && MakeInverse)
+      Load(num_nodes_, [&g](NodeID_ n) { return g.in_neigh(n); }, in_);
+  }
+
+  DynamicGraph(const DynamicGraph &other) = delete;
+  DynamicGraph& operator=(const DynamicGraph &other) = delete;
+
+  ~DynamicGraph() {
+    out_.Release();
+    in_.Release();
+  }
+
+  // Inserts and deletes batch of edges (semantics above)
+  void ApplyBatch(const pvector<Edge> &insertions,
+                  const pvector<Edge> &deletions,
+                  bool logging_enabled = true) {
+    Timer t;
+    t.Start();
+    int64_t change = ApplyToAdjacency(
+        OrientUpdates(insertions, deletions, false), out_);
+    if (directed_ && MakeInverse)
+      ApplyToAdjacency(OrientUpdates(insertions, deletions, true), in_);
+    num_edges_ += directed_ ? change : change / 2;
+    bool repacked = MaybeRepack(num_edges_directed(), out_);
+    if (directed_ && MakeInverse)
+      repacked |= MaybeRepack(num_edges_directed(), in_);
+    t.Stop();
+    if (logging_enabled) {
+      PrintTime("Batch Time", t.Seconds());
+      int64_t num_updates = insertions.size() + deletions.size();
+      PrintStep("Updates/s", static_cast<int64_t>(num_updates / t.Seconds()));
+      if (repacked)
+        std::cout << "Repacked neighborhoods" << std::endl;
+    }
+  }
+
+  // Equivalent CSRGraph with sorted neighborhoods
+  CSRGraphT Compact() const {
+    DestID_ **out_index, *out_neighs;
+    DestID_ **in_index = nullptr, *in_neighs = nullptr;
+    Pack(num_nodes_, [this](NodeID_ n) { return out_neigh(n); }, &out_index,
+         &out_neighs);
+    if (!directed_)
+      return CSRGraphT(num_nodes_, out_index, out_neighs);
+    if (MakeInverse)
+      Pack(num_nodes_, [this](NodeID_ n) { return in_neigh(n); }, &in_index,
+           &in_neighs);
+    return CSRGraphT(num_nodes_, out_index, out_neighs, in_index, in_neighs);
+  }
+
+  bool directed() const {
+    return directed_;
+  }
+
+  int64_t num_nodes() const {
+    return num_nodes_;
+  }
+
+  int64_t num_edges() const {
+    return num_edges_;
+  }
+
+  int64_t num_edges_directed() const {
+    return directed_ ? num_edges_ : 2*num_edges_;
+  }
+
+  int64_t out_degree(NodeID_ v) const {
+    return out_.degrees[v];
+  }
+
+  int64_t in_degree(NodeID_ v) const {
+    static_assert(MakeInverse, "Graph inversion disabled but reading inverse");
+    return directed_ ? in_.degrees[v] : out_.degrees[v];
+  }
+
+  Neighborhood out_neigh(NodeID_ n, OffsetT start_offset = 0) const {
+    return Neighborhood(out_.starts[n], out_.starts[n] + out_.degrees[n],
+                        start_offset);
+  }
+
+  Neighborhood in_neigh(NodeID_ n, OffsetT start_offset = 0) const {
+    static_assert(MakeInverse, "Graph inversion disabled but reading inverse");
+    const Adjacency &adj = directed_ ? in_ : out_;
+    return Neighborhood(adj.starts[n], adj.starts[n] + adj.degrees[n],
+                        start_offset);
+  }
+
+  void PrintStats() const {
+    std::cout << "Graph has " << num_nodes_ << " nodes and "
+              << num_edges_ << " ";
+    if (!directed_)
+      std::cout << "un";
+    std::cout << "directed edges for degree: ";
+    std::cout << num_edges_/num_nodes_ << std::endl;
+  }
+
+  Range<NodeID_> vertices() const {
+    return Range<NodeID_>(num_nodes());
+  }
+};
+
+#endif  // DYNAMIC_GRAPH_H_
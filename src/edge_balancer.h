@@ -0,0 +1,164 @@
+// Copyright (c) 2015, The Regents of the University of California (Regents)
+// See LICENSE.txt for license details
+
+#ifndef EDGE_BALANCER_H_
+#define EDGE_BALANCER_H_
+
+#include <algorithm>
+#include <cinttypes>
+#include <utility>
+
+#include "graph.h"
+#include "pvector.h"
+
+
+/*
+GAP Benchmark Suite
+Class:  EdgeBalancer
+
+Expands a frontier in parallel with the work split evenly by edges
+ - Prefix sums the out-degrees of the frontier and hands out fixed-size
+   ranges of edges, so a high-degree vertex is spread across many threads
+   instead of serializing the step on whichever thread got it
+ - ForEachEdge must be reached by every thread of an enclosing parallel
+   region, which lets callers keep thread-local state (e.g. QueueBuffer)
+ - ForEachEdge does not end with a barrier, so callers must synchronize
+   before changing the frontier or calling it again (nowait lets a thread
+   move on to its own work, such as voting, without waiting on others)
+ - Prefix storage is kept between calls so it can be reused every step
+*/
+
+
+template <typename GraphT_>
+class EdgeBalancer {
+ public:
+  // Positions [first, second) within a vertex's out-neighborhood
+  typedef std::pair<SGOffset, SGOffset> EdgeRange;
+
+  explicit EdgeBalancer(const GraphT_ &g) : g_(g) {}
+
+  // Calls visit(u, v) for every out-edge of each u in the frontier, where v is
+  // a reference to the neighbor stored in the graph. No barrier at the end.
+  template <typename IterT, typename VisitFunc>
+  void ForEachEdge(IterT frontier_begin, IterT frontier_end, VisitFunc visit) {
+    ForEachEdge(frontier_begin, frontier_end, visit, AllEdges(g_));
+  }
+
+  // Same as above, but only visits the out-edges of each u whose positions in
+  // its neighborhood are within the range [first, second) returned by range(u)
+  template <typename IterT, typename VisitFunc, typename RangeFunc>
+  void ForEachEdge(IterT frontier_begin, IterT frontier_end, VisitFunc visit,
+                   RangeFunc range) {
+    const size_t frontier_size = frontier_end - frontier_begin;
+    #pragma omp single
+    {
+      Reserve(frontier_size);
+      if (frontier_size <= kScanBlock)
+        SerialScan(frontier_begin, frontier_size, range);
+    }
+    if (frontier_size > kScanBlock)
+      ParallelScan(frontier_begin, frontier_size, range);
+    const SGOffset num_edges = offsets_[frontier_size];
+    const SGOffset num_chunks = (num_edges + kChunkEdges - 1) / kChunkEdges;
+    #pragma omp for schedule(dynamic, 1) nowait
+    for (SGOffset c=0; c < num_chunks; c++) {
+      SGOffset chunk_start = c * kChunkEdges;
+      SGOffset chunk_end = std::min(chunk_start + kChunkEdges, num_edges);
+      // last frontier vertex whose edges begin at or before chunk_start
+      size_t i = std::upper_bound(offsets_.begin(),
+                                  offsets_.begin() + frontier_size + 1,
+                                  chunk_start) - offsets_.begin() - 1;
+      for (; offsets_[i] < chunk_end; i++) {
+        auto u = frontier_begin[i];
+        auto neigh_start = g_.out_neigh(u).begin() + range(u).first;
+        SGOffset from = std::max(chunk_start, offsets_[i]) - offsets_[i];
+        SGOffset to = std::min(chunk_end, offsets_[i+1]) - offsets_[i];
+        for (auto it = neigh_start + from; it < neigh_start + to; it++)
+          visit(u, *it);
+      }
+    }
+  }
+
+ private:
+  const GraphT_ &g_;
+  pvector<SGOffset> offsets_;
+  pvector<SGOffset> block_sums_;
+
+  static const SGOffset kChunkEdges = 1024;
+  static const size_t kScanBlock = 4096;
+
+  struct AllEdges {
+    const GraphT_ &g;
+    explicit AllEdges(const GraphT_ &g) : g(g) {}
+    template <typename NodeT>
+    EdgeRange operator()(NodeT u) const {
+      return EdgeRange(0, g.out_degree(u));
+    }
+  };
+
+  template <typename NodeT, typename RangeFunc>
+  static SGOffset RangeSize(NodeT u, RangeFunc range) {
+    EdgeRange r = range(u);
+    return r.second - r.first;
+  }
+
+  // not thread-safe, old contents are not kept
+  void Reserve(size_t frontier_size) {
+    if (offsets_.size() < frontier_size + 1) {
+      pvector<SGOffset> bigger(std::max(frontier_size + 1, 2*offsets_.size()));
+      offsets_.swap(bigger);
+    }
+    size_t num_blocks = (frontier_size + kScanBlock - 1) / kScanBlock;
+    if (block_sums_.size() < num_blocks) {
+      pvector<SGOffset> bigger(std::max(num_blocks, 2*block_sums_.size()));
+      block_sums_.swap(bigger);
+    }
+  }
+
+  template <typename IterT, typename RangeFunc>
+  void SerialScan(IterT frontier_begin, size_t frontier_size,
+                  RangeFunc range) {
+    SGOffset total = 0;
+    for (size_t i=0; i < frontier_size; i++) {
+      offsets_[i] = total;
+      total += RangeSize(frontier_begin[i], range);
+    }
+    offsets_[frontier_size] = total;
+  }
+
+  // Same blocked approach as BuilderBase::ParallelPrefixSum, but orphaned so
+  // it runs on the threads of the caller's parallel region
+  template <typename IterT, typename RangeFunc>
+  void ParallelScan(IterT frontier_begin, size_t frontier_size,
+                    RangeFunc range) {
+    const size_t num_blocks = (frontier_size + kScanBlock - 1) / kScanBlock;
+    #pragma omp for
+    for (size_t block=0; block < num_blocks; block++) {
+      SGOffset lsum = 0;
+      size_t block_end = std::min((block + 1) * kScanBlock, frontier_size);
+      for (size_t i=block * kScanBlock; i < block_end; i++) {
+        offsets_[i] = lsum;
+        lsum += RangeSize(frontier_begin[i], range);
+      }
+      block_sums_[block] = lsum;
+    }
+    #pragma omp single
+    {
+      SGOffset total = 0;
+      for (size_t block=0; block < num_blocks; block++) {
+        SGOffset block_total = block_sums_[block];
+        block_sums_[block] = total;
+        total += block_total;
+      }
+      offsets_[frontier_size] = total;
+    }
+    #pragma omp for
+    for (size_t block=0; block < num_blocks; block++) {
+      size_t block_end = std::min((block + 1) * kScanBlock, frontier_size);
+      for (size_t i=block * kScanBlock; i < block_end; i++)
+        offsets_[i] += block_sums_[block];
+    }
+  }
+};
+
+#endif  // EDGE_BALANCER_H_
@@ -0,0 +1,83 @@
+// Copyright (c) 2015, The Regents of the University of California (Regents)
+// See LICENSE.txt for license details
+
+#ifndef EDGE_UPDATE_H_
+#define EDGE_UPDATE_H_
+
+#include <algorithm>
+#include <cinttypes>
+#include <random>
+
+#include "generator.h"
+#include "graph.h"
+#include "pvector.h"
+#include "util.h"
+
+
+/*
+GAP Benchmark Suite
+Class:  UpdateGenerator
+
+Given a graph, generates batches of edge updates (UpdateBatch) for it
+ - Deletions are existing edges picked uniformly at random, so high-degree
+   vertices lose edges in proportion to their degree
+ - Insertions connect uniformly random endpoints, with random weights from
+   [1,255] (Generator::InsertWeights) if the graph is weighted
+ - Each batch is seeded by its number, so the stream is deterministic
+ - Batches are applied to a graph with Builder::ApplyUpdates
+*/
+
+
+template <typename NodeID_, typename DestID_ = NodeID_>
+struct UpdateBatch {
+  pvector<EdgePair<NodeID_, DestID_>> insertions;
+  pvector<EdgePair<NodeID_, DestID_>> deletions;
+};
+
+
+template <typename NodeID_, typename DestID_ = NodeID_,
+          typename WeightT_ = NodeID_>
+class UpdateGenerator {
+  typedef EdgePair<NodeID_, DestID_> Edge;
+  typedef CSRGraph<NodeID_, DestID_> GraphT;
+
+ public:
+  UpdateGenerator(const GraphT &g, int64_t batch_size, int delete_percent)
+      : g_(g), offsets_(g.VertexOffsets()), num_batches_(0) {
+    num_deletions_ = g.num_edges() == 0 ? 0 : batch_size * delete_percent / 100;
+    num_insertions_ = batch_size - num_deletions_;
+  }
+
+  UpdateBatch<NodeID_, DestID_> NextBatch() {
+    UpdateBatch<NodeID_, DestID_> batch;
+    // seeded apart from Generator, which would repeat the graph's own edges
+    std::seed_seq seed{kRandSeed, num_batches_++};
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<NodeID_> node_dist(0, g_.num_nodes()-1);
+    std::uniform_int_distribution<SGOffset> edge_dist(
+        0, g_.num_edges_directed()-1);
+    pvector<Edge> insertions(num_insertions_);
+    for (Edge &e : insertions)
+      e = Edge(node_dist(rng), node_dist(rng));
+    Generator<NodeID_, DestID_, WeightT_>::InsertWeights(insertions);
+    pvector<Edge> deletions(num_deletions_);
+    for (Edge &e : deletions) {
+      SGOffset pos = edge_dist(rng);
+      NodeID_ u = std::upper_bound(offsets_.begin(), offsets_.end(), pos) -
+                  offsets_.begin() - 1;
+      e = Edge(u, g_.out_neigh(u).begin()[pos - offsets_[u]]);
+    }
+    batch.insertions.swap(insertions);
+    batch.deletions.swap(deletions);
+    return batch;
+  }
+
+ private:
+  const GraphT &g_;
+  pvector<SGOffset> offsets_;
+  int64_t num_batches_;
+  int64_t num_insertions_;
+  int64_t num_deletions_;
+};
+
+#endif  // EDGE_UPDATE_H_
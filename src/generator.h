@@ -21,6 +21,8 @@ Author: Scott Beamer
 Given scale and degree, generates edgelist for synthetic graph
  - Intended to be called from Builder
  - GenerateEL(uniform) generates and returns the edgelist
+ - GenerateELChunks(uniform, process, chunk_size) generates the same edges a
+   chunk at a time, for consumers that never need the whole edgelist
  - Can generate uniform random (uniform=true) or R-MAT graph according
    to Graph500 parameters (uniform=false)
  - Can also randomize weights within a weighted edgelist (InsertWeights)
@@ -49,46 +51,64 @@ class Generator {
     }
   }
 
-  void PermuteIDs(EdgeList &el) {
+  pvector<NodeID_> MakePermutation() {
     pvector<NodeID_> permutation(num_nodes_);
     std::mt19937 rng(kRandSeed);
     #pragma omp parallel for
     for (NodeID_ n=0; n < num_nodes_; n++)
       permutation[n] = n;
     shuffle(permutation.begin(), permutation.end(), rng);
+    return permutation;
+  }
+
+  static void PermuteIDs(EdgeList &el,
+                         const pvector<NodeID_> &permutation) {
+    int64_t el_size = el.size();
     #pragma omp parallel for
-    for (int64_t e=0; e < num_edges_; e++)
+    for (int64_t e=0; e < el_size; e++)
       el[e] = Edge(permutation[el[e].u], permutation[el[e].v]);
   }
 
-  EdgeList MakeUniformEL() {
-    EdgeList el(num_edges_);
+  void PermuteIDs(EdgeList &el) {
+    PermuteIDs(el, MakePermutation());
+  }
+
+  // Fills el with the edges of the uniform edgelist starting at first (a
+  // multiple of block_size), so chunks of it can be generated separately
+  void FillUniformEL(EdgeList &el, int64_t first = 0) {
+    int64_t el_size = el.size();
     #pragma omp parallel
     {
       std::mt19937 rng;
       std::uniform_int_distribution<NodeID_> udist(0, num_nodes_-1);
       #pragma omp for
-      for (int64_t block=0; block < num_edges_; block+=block_size) {
-        rng.seed(kRandSeed + block/block_size);
-        for (int64_t e=block; e < std::min(block+block_size, num_edges_); e++) {
+      for (int64_t block=0; block < el_size; block+=block_size) {
+        rng.seed(kRandSeed + (first + block)/block_size);
+        for (int64_t e=block; e < std::min(block+block_size, el_size); e++) {
           el[e] = Edge(udist(rng), udist(rng));
         }
       }
     }
+  }
+
+  EdgeList MakeUniformEL() {
+    EdgeList el(num_edges_);
+    FillUniformEL(el);
     return el;
   }
 
-  EdgeList MakeRMatEL() {
+  // Same as FillUniformEL, but for the R-MAT edgelist before PermuteIDs
+  void FillRMatEL(EdgeList &el, int64_t first = 0) {
     const float A = 0.57f, B = 0.19f, C = 0.19f;
-    EdgeList el(num_edges_);
+    int64_t el_size = el.size();
     #pragma omp parallel
     {
       std::mt19937 rng;
       std::uniform_real_distribution<float> udist(0, 1.0f);
       #pragma omp for
-      for (int64_t block=0; block < num_edges_; block+=block_size) {
-        rng.seed(kRandSeed + block/block_size);
-        for (int64_t e=block; e < std::min(block+block_size, num_edges_); e++) {
+      for (int64_t block=0; block < el_size; block+=block_size) {
+        rng.seed(kRandSeed + (first + block)/block_size);
+        for (int64_t e=block; e < std::min(block+block_size, el_size); e++) {
           NodeID_ src = 0, dst = 0;
           for (int depth=0; depth < scale_; depth++) {
             float rand_point = udist(rng);
@@ -107,6 +127,11 @@ class Generator {
         }
       }
     }
+  }
+
+  EdgeList MakeRMatEL() {
+    EdgeList el(num_edges_);
+    FillRMatEL(el);
     PermuteIDs(el);
     // TIME_PRINT("Shuffle", std::shuffle(el.begin(), el.end(),
     //                                    std::mt19937()));
@@ -126,6 +151,28 @@ class Generator {
     return el;
   }
 
+  // Generates the same edges as GenerateEL, but hands them to process one
+  // chunk (of about chunk_size edges) at a time, never holding all of them
+  template <typename ChunkFunc>
+  void GenerateELChunks(bool uniform, ChunkFunc process,
+                        int64_t chunk_size) {
+    chunk_size = std::max(chunk_size / block_size, int64_t(1)) * block_size;
+    pvector<NodeID_> permutation;
+    if (!uniform)
+      permutation = MakePermutation();
+    EdgeList el(std::min(chunk_size, num_edges_));
+    for (int64_t first=0; first < num_edges_; first+=chunk_size) {
+      el.resize(std::min(chunk_size, num_edges_ - first));
+      if (uniform) {
+        FillUniformEL(el, first);
+      } else {
+        FillRMatEL(el, first);
+        PermuteIDs(el, permutation);
+      }
+      process(el);
+    }
+  }
+
   static void InsertWeights(pvector<EdgePair<NodeID_, NodeID_>> &el) {}
 
   // Overwrites existing weights with random from [1,255]
@@ -49,7 +49,7 @@ struct NodeWeight {
     return v == rhs;
   }
 
-  operator NodeID_() {
+  operator NodeID_() const {
     return v;
   }
 };
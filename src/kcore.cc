@@ -0,0 +1,248 @@
+// Copyright (c) 2015, The Regents of the University of California (Regents)
+// See LICENSE.txt for license details
+
+#include <algorithm>
+#include <cinttypes>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+#include "benchmark.h"
+#include "bin_pool.h"
+#include "bitmap.h"
+#include "builder.h"
+#include "command_line.h"
+#include "graph.h"
+#include "platform_atomics.h"
+#include "pvector.h"
+#include "sliding_queue.h"
+
+
+/*
+GAP Benchmark Suite
+Kernel: k-Core Decomposition (kcore)
+
+Will return the core number of every vertex, which is the largest k such that
+it is in the k-core (the largest subgraph in which every vertex has degree at
+least k)
+
+Requires input graph:
+  - to be undirected
+  - no duplicate edges
+
+This implementation peels vertices in order of their degree in what is left
+of the graph, with buckets of vertices by degree as in Julienne [1]. The
+lowest non-empty bucket (k) is peeled in rounds: each round assigns core
+number k to the frontier (starting with the bucket), and decrements the
+degrees of their remaining neighbors atomically. A neighbor whose degree falls
+to k joins the next round's frontier, and degrees are never decremented below
+k. A neighbor whose degree stays above k is moved (once per round, after it)
+to the bucket of its new degree. Once the frontier is empty, the next
+non-empty bucket is peeled.
+
+The buckets are thread-local LocalBins (as in delta-stepping) that are not
+cleaned when a vertex moves, so a vertex drained from a bucket it is no longer
+in is skipped. Each vertex is added to a bucket at most once per round in
+which its degree changes, so the work is O(|V| + |E|) plus the number of
+buckets scanned.
+
+The verifier is the serial O(|V| + |E|) algorithm of Batagelj and
+Zaversnik [2].
+
+[1] Laxman Dhulipala, Guy Blelloch, and Julian Shun. "Julienne: A framework
+    for parallel graph algorithms using work-efficient bucketing." ACM
+    Symposium on Parallelism in Algorithms and Architectures (SPAA), 2017.
+
+[2] Vladimir Batagelj and Matjaz Zaversnik. "An O(m) algorithm for cores
+    decomposition of networks." arXiv:cs/0310049, 2003.
+*/
+
+
+using namespace std;
+
+
+pvector<NodeID> PeelCores(const Graph &g, BinPool<NodeID> &bin_pool,
+                          bool logging_enabled = true) {
+  pvector<NodeID> core(g.num_nodes());
+  pvector<NodeID> degree(g.num_nodes());
+  Bitmap peeled(g.num_nodes());
+  Bitmap moved(g.num_nodes());
+  peeled.reset();
+  moved.reset();
+  SlidingQueue<NodeID> frontier(g.num_nodes());
+  SlidingQueue<NodeID> moved_queue(g.num_nodes());
+  #pragma omp parallel
+  {
+    LocalBins<NodeID> &local_bins = bin_pool.local();
+    local_bins.clear();
+    #pragma omp for
+    for (NodeID n=0; n < g.num_nodes(); n++) {
+      degree[n] = g.out_degree(n);
+      local_bins.push_back(degree[n], n);
+    }
+  }
+  const size_t kNoBin = numeric_limits<size_t>::max();
+  size_t k = 0;
+  int64_t num_rounds = 0;
+  while (true) {
+    size_t next_k = kNoBin;
+    #pragma omp parallel reduction(min : next_k)
+    {
+      LocalBins<NodeID> &local_bins = bin_pool.local();
+      size_t local_next = local_bins.first_nonempty(k);
+      if (local_next < local_bins.num_bins())
+        next_k = local_next;
+    }
+    if (next_k == kNoBin)
+      break;
+    k = next_k;
+    const NodeID level = static_cast<NodeID>(k);
+    // Drain bucket k, skipping vertices since peeled or moved lower
+    #pragma omp parallel
+    {
+      LocalBins<NodeID> &local_bins = bin_pool.local();
+      vector<NodeID> bucket;
+      local_bins.drain(k, bucket);
+      QueueBuffer<NodeID> lfrontier(frontier);
+      for (NodeID u : bucket) {
+        if ((degree[u] == level) && peeled.set_bit_atomic(u)) {
+          core[u] = level;
+          lfrontier.push_back(u);
+        }
+      }
+      lfrontier.flush();
+    }
+    frontier.slide_window();
+    while (!frontier.empty()) {
+      num_rounds++;
+      #pragma omp parallel
+      {
+        QueueBuffer<NodeID> lfrontier(frontier);
+        QueueBuffer<NodeID> lmoved(moved_queue);
+        #pragma omp for schedule(dynamic, 64) nowait
+        for (auto it = frontier.begin(); it < frontier.end(); it++) {
+          for (NodeID v : g.out_neigh(*it)) {
+            if (peeled.get_bit(v))
+              continue;
+            NodeID old_degree = fetch_and_add(degree[v], -1);
+            if (old_degree <= level) {
+              fetch_and_add(degree[v], 1);
+            } else if (old_degree == level + 1) {
+              if (peeled.set_bit_atomic(v)) {
+                core[v] = level;
+                lfrontier.push_back(v);
+              }
+            } else if (!moved.get_bit(v) && moved.set_bit_atomic(v)) {
+              lmoved.push_back(v);
+            }
+          }
+        }
+        lfrontier.flush();
+        lmoved.flush();
+      }
+      frontier.slide_window();
+      moved_queue.slide_window();
+      #pragma omp parallel
+      {
+        LocalBins<NodeID> &local_bins = bin_pool.local();
+        #pragma omp for nowait
+        for (auto it = moved_queue.begin(); it < moved_queue.end(); it++) {
+          moved.clear_bit_atomic(*it);
+          if (!peeled.get_bit(*it))
+            local_bins.push_back(degree[*it], *it);
+        }
+      }
+      moved_queue.reset();
+    }
+  }
+  if (logging_enabled)
+    PrintStep("Peeling Rounds", num_rounds);
+  return core;
+}
+
+
+void PrintCoreStats(const Graph &g, const pvector<NodeID> &core) {
+  NodeID max_core = 0;
+  int64_t num_in_max = 0;
+  for (NodeID n : g.vertices()) {
+    if (core[n] > max_core) {
+      max_core = core[n];
+      num_in_max = 0;
+    }
+    num_in_max += core[n] == max_core;
+  }
+  cout << "max core: " << max_core << " (" << num_in_max << " vertices)"
+       << endl;
+}
+
+
+// Compares with serial Batagelj-Zaversnik, which keeps vertices sorted by
+// remaining degree (bin sort) and moves each neighbor of a removed vertex to
+// the front of its degree's block before decrementing it
+bool CoreVerifier(const Graph &g, const pvector<NodeID> &test_core) {
+  int64_t max_degree = 0;
+  for (NodeID n : g.vertices())
+    max_degree = max(max_degree, g.out_degree(n));
+  vector<NodeID> degree(g.num_nodes());
+  vector<int64_t> bin_start(max_degree + 1, 0);
+  for (NodeID n : g.vertices()) {
+    degree[n] = g.out_degree(n);
+    bin_start[degree[n]]++;
+  }
+  int64_t start = 0;
+  for (int64_t d=0; d <= max_degree; d++) {
+    int64_t count = bin_start[d];
+    bin_start[d] = start;
+    start += count;
+  }
+  vector<NodeID> sorted(g.num_nodes());
+  vector<int64_t> position(g.num_nodes());
+  for (NodeID n : g.vertices()) {
+    position[n] = bin_start[degree[n]]++;
+    sorted[position[n]] = n;
+  }
+  for (int64_t d=max_degree; d > 0; d--)
+    bin_start[d] = bin_start[d-1];
+  bin_start[0] = 0;
+  for (int64_t i=0; i < g.num_nodes(); i++) {
+    NodeID u = sorted[i];
+    for (NodeID v : g.out_neigh(u)) {
+      if (degree[v] > degree[u]) {
+        NodeID front = sorted[bin_start[degree[v]]];
+        if (front != v) {
+          swap(sorted[position[v]], sorted[bin_start[degree[v]]]);
+          swap(position[v], position[front]);
+        }
+        bin_start[degree[v]]++;
+        degree[v]--;
+      }
+    }
+  }
+  bool all_ok = true;
+  for (NodeID n : g.vertices()) {
+    if (degree[n] != test_core[n]) {
+      cout << n << ": " << test_core[n] << " != " << degree[n] << endl;
+      all_ok = false;
+    }
+  }
+  return all_ok;
+}
+
+
+int main(int argc, char* argv[]) {
+  CLApp cli(argc, argv, "k-core decomposition");
+  if (!cli.ParseArgs())
+    return -1;
+  Builder b(cli);
+  Graph g = b.MakeGraph();
+  if (g.directed()) {
+    cout << "Input graph is directed but kcore requires undirected" << endl;
+    return -2;
+  }
+  BinPool<NodeID> bin_pool;
+  auto PeelBound = [&bin_pool] (const Graph &g) {
+    return PeelCores(g, bin_pool);
+  };
+  BenchmarkKernel(cli, g, PeelBound, PrintCoreStats, CoreVerifier);
+  return 0;
+}
@@ -0,0 +1,198 @@
+// Copyright (c) 2015, The Regents of the University of California (Regents)
+// See LICENSE.txt for license details
+
+#include <algorithm>
+#include <cinttypes>
+#include <iostream>
+#include <vector>
+
+#include "benchmark.h"
+#include "builder.h"
+#include "command_line.h"
+#include "graph.h"
+#include "pvector.h"
+#include "sliding_queue.h"
+
+
+/*
+GAP Benchmark Suite
+Kernel: Maximal Independent Set (MIS)
+
+Will return whether each vertex is in a maximal independent set: a set with
+no two neighbors in it, to which no vertex can be added
+
+Requires input graph:
+  - to be undirected
+  - no self loops
+
+This implementation is Luby's algorithm [1] with the priorities fixed up
+front, as in [2]. Every vertex has a pseudorandom priority (by hashing with
+kRandSeed, with ties broken by ID). Each round, every undecided vertex that
+precedes all of its undecided neighbors joins the set, and then its neighbors
+are taken out. The undecided vertices left make up the next round's frontier.
+
+With the priorities fixed, a vertex joins exactly when none of the neighbors
+that precede it join, so the result is the same set serial greedy finds
+adding vertices in priority order, and the number of rounds is logarithmic
+with high probability [2]. The verifier checks it is that set, besides
+checking it is independent and maximal.
+
+[1] Michael Luby. "A simple parallel algorithm for the maximal independent
+    set problem." SIAM Journal on Computing, 1986.
+
+[2] Guy E. Blelloch, Jeremy T. Fineman, and Julian Shun. "Greedy sequential
+    maximal independent set and matching are parallel on average." ACM
+    Symposium on Parallelism in Algorithms and Architectures (SPAA), 2012.
+*/
+
+
+using namespace std;
+
+enum MISState : uint8_t {kUndecided, kIn, kOut};
+
+
+inline
+bool Precedes(const pvector<uint64_t> &priority, NodeID u, NodeID v) {
+  return priority[u] != priority[v] ? priority[u] > priority[v] : u < v;
+}
+
+
+pvector<uint64_t> Priorities(const Graph &g) {
+  pvector<uint64_t> priority(g.num_nodes());
+  #pragma omp parallel for
+  for (NodeID n=0; n < g.num_nodes(); n++)
+    priority[n] = SeededHash(n);
+  return priority;
+}
+
+
+pvector<MISState> LubyMIS(const Graph &g, bool logging_enabled = true) {
+  pvector<uint64_t> priority = Priorities(g);
+  pvector<MISState> state(g.num_nodes());
+  SlidingQueue<NodeID> queue_a(g.num_nodes());
+  SlidingQueue<NodeID> queue_b(g.num_nodes());
+  SlidingQueue<NodeID> *frontier = &queue_a;
+  SlidingQueue<NodeID> *undecided = &queue_b;
+  SlidingQueue<NodeID> joining(g.num_nodes());
+  #pragma omp parallel
+  {
+    QueueBuffer<NodeID> lfrontier(*frontier);
+    #pragma omp for nowait
+    for (NodeID n=0; n < g.num_nodes(); n++) {
+      state[n] = kUndecided;
+      lfrontier.push_back(n);
+    }
+    lfrontier.flush();
+  }
+  frontier->slide_window();
+  int64_t num_rounds = 0;
+  while (!frontier->empty()) {
+    num_rounds++;
+    #pragma omp parallel
+    {
+      QueueBuffer<NodeID> ljoining(joining);
+      #pragma omp for schedule(dynamic, 64) nowait
+      for (auto it = frontier->begin(); it < frontier->end(); it++) {
+        NodeID u = *it;
+        bool first = true;
+        for (NodeID v : g.out_neigh(u)) {
+          if ((state[v] == kUndecided) && Precedes(priority, v, u)) {
+            first = false;
+            break;
+          }
+        }
+        if (first)
+          ljoining.push_back(u);
+      }
+      ljoining.flush();
+    }
+    joining.slide_window();
+    #pragma omp parallel for schedule(dynamic, 64)
+    for (auto it = joining.begin(); it < joining.end(); it++) {
+      state[*it] = kIn;
+      for (NodeID v : g.out_neigh(*it))
+        state[v] = kOut;
+    }
+    joining.reset();
+    #pragma omp parallel
+    {
+      QueueBuffer<NodeID> lundecided(*undecided);
+      #pragma omp for nowait
+      for (auto it = frontier->begin(); it < frontier->end(); it++) {
+        if (state[*it] == kUndecided)
+          lundecided.push_back(*it);
+      }
+      lundecided.flush();
+    }
+    undecided->slide_window();
+    frontier->reset();
+    swap(frontier, undecided);
+  }
+  if (logging_enabled)
+    PrintStep("Rounds", num_rounds);
+  return state;
+}
+
+
+void PrintMISStats(const Graph &g, const pvector<MISState> &state) {
+  int64_t set_size = count(state.begin(), state.end(), kIn);
+  cout << "set has " << set_size << " of " << g.num_nodes() << " vertices"
+       << endl;
+}
+
+
+// Independent, maximal, and the same as serial greedy in priority order
+bool MISVerifier(const Graph &g, const pvector<MISState> &state) {
+  bool all_ok = true;
+  for (NodeID u : g.vertices()) {
+    bool has_neighbor_in = false;
+    for (NodeID v : g.out_neigh(u))
+      has_neighbor_in |= state[v] == kIn;
+    if ((state[u] == kIn) && has_neighbor_in) {
+      cout << u << " and a neighbor both in set" << endl;
+      all_ok = false;
+    } else if ((state[u] != kIn) && !has_neighbor_in) {
+      cout << u << " could be added to set" << endl;
+      all_ok = false;
+    }
+  }
+  pvector<uint64_t> priority = Priorities(g);
+  vector<NodeID> order(g.num_nodes());
+  for (NodeID n : g.vertices())
+    order[n] = n;
+  sort(order.begin(), order.end(), [&priority](NodeID u, NodeID v) {
+    return Precedes(priority, u, v);
+  });
+  vector<bool> in_set(g.num_nodes(), false);
+  vector<bool> excluded(g.num_nodes(), false);
+  for (NodeID u : order) {
+    if (excluded[u])
+      continue;
+    in_set[u] = true;
+    for (NodeID v : g.out_neigh(u))
+      excluded[v] = true;
+  }
+  for (NodeID n : g.vertices()) {
+    if (in_set[n] != (state[n] == kIn)) {
+      cout << n << ": differs from serial greedy" << endl;
+      all_ok = false;
+    }
+  }
+  return all_ok;
+}
+
+
+int main(int argc, char* argv[]) {
+  CLApp cli(argc, argv, "maximal independent set");
+  if (!cli.ParseArgs())
+    return -1;
+  Builder b(cli);
+  Graph g = b.MakeGraph();
+  if (g.directed()) {
+    cout << "Input graph is directed but mis requires undirected" << endl;
+    return -2;
+  }
+  auto MISBound = [] (const Graph &g) { return LubyMIS(g); };
+  BenchmarkKernel(cli, g, MISBound, PrintMISStats, MISVerifier);
+  return 0;
+}
@@ -0,0 +1,274 @@
+// Copyright (c) 2015, The Regents of the University of California (Regents)
+// See LICENSE.txt for license details
+
+#include <algorithm>
+#include <cinttypes>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+#include "benchmark.h"
+#include "bitmap.h"
+#include "builder.h"
+#include "cc.h"
+#include "command_line.h"
+#include "graph.h"
+#include "platform_atomics.h"
+#include "pvector.h"
+#include "sliding_queue.h"
+
+
+/*
+GAP Benchmark Suite
+Kernel: Minimum Spanning Forest (MSF)
+
+Will return the edges of a minimum spanning forest: a minimum spanning tree of
+each connected component
+
+Requires input graph:
+  - to be undirected
+  - neighborhoods sorted by weight (SortByWeight)
+
+This implementation is Boruvka's algorithm [1], with the components kept in a
+union-find tree as in Afforest (cc.h). Each round, every component picks its
+lightest edge to another component, and is linked (Link) with the component
+at the other end, after which the trees are compressed (Compress). It ends
+once no component has an edge leaving it.
+
+Each vertex picks its lightest edge leaving its component and then writes it
+into its component's slot with a priority write (a compare-and-swap loop that
+only lowers it). An edge is packed in 64 bits as its weight followed by the
+component at the other end, so ties between equally light edges go to the
+lowest component, which is enough to keep the picked edges from forming a
+cycle (other than two components picking each other, of which only the lower
+one links). A second pass finds a vertex with an edge matching each slot to
+recover its endpoints.
+
+Since edges never leave a component once in it, each vertex keeps how many of
+the lightest edges in its neighborhood are known to be inside its component
+and skips them in later rounds. Because the neighborhood is sorted, a vertex
+also stops reading once its edges get heavier than the first one out.
+
+The verifier compares the total weight with serial Kruskal [2] and checks the
+result is a forest of edges in the graph with as many edges as Kruskal's.
+
+[1] Otakar Boruvka. "O jistem problemu minimalnim." Prace Moravske
+    Prirodovedecke Spolecnosti, 1926.
+
+[2] Joseph B. Kruskal. "On the shortest spanning subtree of a graph and the
+    traveling salesman problem." Proceedings of the American Mathematical
+    Society, 1956.
+*/
+
+
+using namespace std;
+
+typedef EdgePair<NodeID, WNode> WEdge;
+
+static_assert((sizeof(WeightT) == 4) && (sizeof(NodeID) == 4),
+              "MSF packs a weight and a NodeID into 64 bits");
+
+const uint64_t kNoEdge = numeric_limits<uint64_t>::max();
+
+
+// Flipping the sign bit keeps negative weights ordered first when unsigned
+inline uint64_t PackEdge(WeightT w, NodeID comp) {
+  uint64_t key_w = static_cast<uint32_t>(w) ^ (static_cast<uint32_t>(1) << 31);
+  return (key_w << 32) | static_cast<uint32_t>(comp);
+}
+
+inline WeightT KeyWeight(uint64_t key) {
+  return static_cast<WeightT>(static_cast<uint32_t>(key >> 32) ^
+                              (static_cast<uint32_t>(1) << 31));
+}
+
+inline NodeID KeyComp(uint64_t key) {
+  return static_cast<NodeID>(static_cast<uint32_t>(key));
+}
+
+
+pvector<WEdge> Boruvka(const WGraph &g, bool logging_enabled = true) {
+  pvector<NodeID> comp(g.num_nodes());
+  pvector<uint64_t> lightest(g.num_nodes(), kNoEdge);
+  pvector<NodeID> num_inside(g.num_nodes(), 0);
+  pvector<WEdge> picked(g.num_nodes());
+  Bitmap found(g.num_nodes());
+  SlidingQueue<WEdge> forest(g.num_nodes());
+  #pragma omp parallel for
+  for (NodeID n=0; n < g.num_nodes(); n++)
+    comp[n] = n;
+  int num_rounds = 0;
+  int64_t num_picked = 1;
+  while (num_picked != 0) {
+    num_rounds++;
+    num_picked = 0;
+    #pragma omp parallel for schedule(dynamic, 1024)
+    for (NodeID u=0; u < g.num_nodes(); u++) {
+      NodeID u_comp = comp[u];
+      uint64_t key = kNoEdge;
+      for (WNode wn : g.out_neigh(u, num_inside[u])) {
+        NodeID v_comp = comp[wn.v];
+        if (v_comp == u_comp) {
+          num_inside[u] += key == kNoEdge;
+        } else if (key == kNoEdge) {
+          key = PackEdge(wn.w, v_comp);
+        } else if (wn.w == KeyWeight(key)) {
+          key = min(key, PackEdge(wn.w, v_comp));
+        } else {
+          break;
+        }
+      }
+      uint64_t old_key = lightest[u_comp];
+      while ((key < old_key) &&
+             !compare_and_swap(lightest[u_comp], old_key, key))
+        old_key = lightest[u_comp];
+    }
+    // Recover endpoints of each component's picked edge
+    found.reset();
+    #pragma omp parallel for schedule(dynamic, 1024) reduction(+ : num_picked)
+    for (NodeID u=0; u < g.num_nodes(); u++) {
+      NodeID u_comp = comp[u];
+      uint64_t key = lightest[u_comp];
+      if ((key == kNoEdge) || found.get_bit(u_comp))
+        continue;
+      for (WNode wn : g.out_neigh(u, num_inside[u])) {
+        if (wn.w > KeyWeight(key))
+          break;
+        if ((wn.w == KeyWeight(key)) && (comp[wn.v] == KeyComp(key))) {
+          if (found.set_bit_atomic(u_comp)) {
+            picked[u_comp] = WEdge(u, wn);
+            num_picked++;
+          }
+          break;
+        }
+      }
+    }
+    #pragma omp parallel
+    {
+      QueueBuffer<WEdge> lforest(forest);
+      #pragma omp for nowait
+      for (NodeID c=0; c < g.num_nodes(); c++) {
+        if (!found.get_bit(c))
+          continue;
+        NodeID other = KeyComp(lightest[c]);
+        if ((KeyComp(lightest[other]) != c) || (c < other)) {
+          lforest.push_back(picked[c]);
+          Link(c, other, comp);
+        }
+      }
+      lforest.flush();
+    }
+    #pragma omp parallel for
+    for (NodeID c=0; c < g.num_nodes(); c++)
+      lightest[c] = kNoEdge;
+    Compress(g, comp);
+  }
+  forest.slide_window();
+  if (logging_enabled)
+    PrintStep("Boruvka Rounds", static_cast<int64_t>(num_rounds));
+  pvector<WEdge> forest_edges(forest.size());
+  copy(forest.begin(), forest.end(), forest_edges.begin());
+  return forest_edges;
+}
+
+
+void PrintMSFStats(const WGraph &g, const pvector<WEdge> &forest) {
+  int64_t total_weight = 0;
+  for (WEdge e : forest)
+    total_weight += e.v.w;
+  cout << "forest has " << forest.size() << " edges ("
+       << g.num_nodes() - forest.size() << " trees) of total weight "
+       << total_weight << endl;
+}
+
+
+NodeID FindRoot(vector<NodeID> &parent, NodeID n) {
+  while (parent[n] != n) {
+    parent[n] = parent[parent[n]];
+    n = parent[n];
+  }
+  return n;
+}
+
+
+// Compares with serial Kruskal, which adds edges in order of increasing
+// weight unless they would close a cycle (found with a union-find)
+bool MSFVerifier(const WGraph &g, const pvector<WEdge> &test_forest) {
+  vector<WEdge> edges;
+  edges.reserve(g.num_edges());
+  for (NodeID u : g.vertices()) {
+    for (WNode wn : g.out_neigh(u)) {
+      if (u < wn.v)
+        edges.push_back(WEdge(u, wn));
+    }
+  }
+  sort(edges.begin(), edges.end(), [](const WEdge &a, const WEdge &b) {
+    return a.v.w < b.v.w;
+  });
+  vector<NodeID> parent(g.num_nodes());
+  for (NodeID n : g.vertices())
+    parent[n] = n;
+  int64_t num_edges = 0;
+  int64_t total_weight = 0;
+  for (WEdge e : edges) {
+    NodeID u_root = FindRoot(parent, e.u);
+    NodeID v_root = FindRoot(parent, e.v.v);
+    if (u_root != v_root) {
+      parent[u_root] = v_root;
+      num_edges++;
+      total_weight += e.v.w;
+    }
+  }
+  bool all_ok = true;
+  for (NodeID n : g.vertices())
+    parent[n] = n;
+  int64_t test_weight = 0;
+  for (WEdge e : test_forest) {
+    NodeID u = e.u;
+    WNode wn = e.v;
+    if (g.out_degree(u) > g.out_degree(wn.v))
+      swap(u, wn.v);
+    auto neigh = g.out_neigh(u);
+    auto SameEdge = [&wn](const WNode &x) {
+      return (x.v == wn.v) && (x.w == wn.w);
+    };
+    if (find_if(neigh.begin(), neigh.end(), SameEdge) == neigh.end()) {
+      cout << "(" << e.u << ", " << e.v.v << ") not an edge" << endl;
+      all_ok = false;
+    }
+    NodeID u_root = FindRoot(parent, e.u);
+    NodeID v_root = FindRoot(parent, e.v.v);
+    if (u_root == v_root) {
+      cout << "(" << e.u << ", " << e.v.v << ") closes a cycle" << endl;
+      all_ok = false;
+    }
+    parent[u_root] = v_root;
+    test_weight += e.v.w;
+  }
+  if (static_cast<int64_t>(test_forest.size()) != num_edges) {
+    cout << test_forest.size() << " edges != " << num_edges << endl;
+    all_ok = false;
+  }
+  if (test_weight != total_weight) {
+    cout << "total weight " << test_weight << " != " << total_weight << endl;
+    all_ok = false;
+  }
+  return all_ok;
+}
+
+
+int main(int argc, char* argv[]) {
+  CLApp cli(argc, argv, "minimum spanning forest");
+  if (!cli.ParseArgs())
+    return -1;
+  WeightedBuilder b(cli);
+  WGraph g = b.MakeGraph();
+  if (g.directed()) {
+    cout << "Input graph is directed but msf requires undirected" << endl;
+    return -2;
+  }
+  WeightedBuilder::SortByWeight(g);
+  auto BoruvkaBound = [] (const WGraph &g) { return Boruvka(g); };
+  BenchmarkKernel(cli, g, BoruvkaBound, PrintMSFStats, MSFVerifier);
+  return 0;
+}
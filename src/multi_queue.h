@@ -0,0 +1,140 @@
+// Copyright (c) 2015, The Regents of the University of California (Regents)
+// See LICENSE.txt for license details
+
+#ifndef MULTI_QUEUE_H_
+#define MULTI_QUEUE_H_
+
+#include <algorithm>
+#include <cinttypes>
+#include <functional>
+#include <limits>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "platform_atomics.h"
+#include "util.h"
+
+
+/*
+GAP Benchmark Suite
+Class:  MultiQueue
+
+Relaxed concurrent priority queue made of several locked sequential heaps [1]
+ - push inserts into a random heap, pop takes the better top of two random
+   heaps, so with c heaps per thread contention stays low while popped items
+   are still close to the global minimum (but not guaranteed to be it)
+ - Heaps are locked with try-locks, a thread that fails to get one just picks
+   another heap instead of waiting
+ - pop can fail even if the queue is not empty (e.g. when the last items are
+   being pushed concurrently), so callers need their own termination check
+
+[1] Hamza Rihani, Peter Sanders, and Roman Dementiev. "MultiQueues: Simple
+    relaxed concurrent priority queues." Symposium on Parallelism in
+    Algorithms and Architectures (SPAA), pages 80-82, 2015.
+*/
+
+
+template <typename PriorityT_, typename T_>
+class MultiQueue {
+  typedef std::pair<PriorityT_, T_> Entry;
+
+  static const int kQueuesPerThread = 2;
+  static const int kPopAttempts = 8;
+  static const size_t kCacheLineSize = 64;
+
+  // Padded so neighboring heaps (and generators) don't share cache lines
+  struct Heap {
+    int32_t locked;
+    PriorityT_ top;
+    std::vector<Entry> entries;
+    char padding[kCacheLineSize];
+  };
+
+  struct Generator {
+    std::minstd_rand rng;
+    char padding[kCacheLineSize];
+  };
+
+  std::vector<Heap> heaps_;
+  std::vector<Generator> generators_;
+
+  static PriorityT_ kEmpty() { return std::numeric_limits<PriorityT_>::max(); }
+
+  bool TryLock(Heap &h) {
+    return (h.locked == 0) && compare_and_swap(h.locked, 0, 1);
+  }
+
+  void Unlock(Heap &h) {
+    compare_and_swap(h.locked, 1, 0);
+  }
+
+  // Caller must hold lock on h
+  void PopFrom(Heap &h, PriorityT_ &priority, T_ &value) {
+    std::pop_heap(h.entries.begin(), h.entries.end(), std::greater<Entry>());
+    priority = h.entries.back().first;
+    value = h.entries.back().second;
+    h.entries.pop_back();
+    h.top = h.entries.empty() ? kEmpty() : h.entries.front().first;
+  }
+
+  // Locks h and pops from it if it is non-empty
+  bool TryPopFrom(Heap &h, PriorityT_ &priority, T_ &value) {
+    if ((h.top == kEmpty()) || !TryLock(h))
+      return false;
+    bool found = !h.entries.empty();
+    if (found)
+      PopFrom(h, priority, value);
+    Unlock(h);
+    return found;
+  }
+
+  size_t RandomHeap() {
+    return generators_[ThreadNum()].rng() % heaps_.size();
+  }
+
+ public:
+  MultiQueue() : heaps_(kQueuesPerThread * MaxThreads()),
+                 generators_(MaxThreads()) {
+    for (Heap &h : heaps_) {
+      h.locked = 0;
+      h.top = kEmpty();
+    }
+    for (size_t t=0; t < generators_.size(); t++)
+      generators_[t].rng.seed(kRandSeed + t);
+  }
+
+  void push(PriorityT_ priority, T_ value) {
+    while (true) {
+      Heap &h = heaps_[RandomHeap()];
+      if (TryLock(h)) {
+        h.entries.push_back(Entry(priority, value));
+        std::push_heap(h.entries.begin(), h.entries.end(),
+                       std::greater<Entry>());
+        h.top = h.entries.front().first;
+        Unlock(h);
+        return;
+      }
+    }
+  }
+
+  // Pops an item with a small (likely but not surely minimal) priority,
+  // returns false if none was found
+  bool pop(PriorityT_ &priority, T_ &value) {
+    for (int attempt=0; attempt < kPopAttempts; attempt++) {
+      Heap &a = heaps_[RandomHeap()];
+      Heap &b = heaps_[RandomHeap()];
+      if (TryPopFrom(a.top <= b.top ? a : b, priority, value))
+        return true;
+    }
+    // Few items left, so look through all heaps before giving up
+    size_t start = RandomHeap();
+    for (size_t i=0; i < heaps_.size(); i++) {
+      if (TryPopFrom(heaps_[(start + i) % heaps_.size()], priority, value))
+        return true;
+    }
+    return false;
+  }
+};
+
+#endif  // MULTI_QUEUE_H_
@@ -0,0 +1,193 @@
+// Copyright (c) 2015, The Regents of the University of California (Regents)
+// See LICENSE.txt for license details
+
+#ifndef PATH_REPAIR_H_
+#define PATH_REPAIR_H_
+
+#include <cinttypes>
+#include <iostream>
+
+#include "benchmark.h"
+#include "bitmap.h"
+#include "builder.h"
+#include "edge_update.h"
+#include "graph.h"
+#include "multi_queue.h"
+#include "platform_atomics.h"
+#include "pvector.h"
+#include "shortest_path.h"
+#include "sliding_queue.h"
+
+
+/*
+GAP Benchmark Suite
+File:   Path Repair
+
+Repairs a shortest-path tree (dist and parent) from a source after a batch of
+edge updates (UpdateBatch), so only the affected region is searched again
+ - Works over a Graph (BFS, every edge has length 1) or a WGraph (SSSP)
+ - parent[source] = source, and unreachable vertices have parent -1 and
+   distance kDistInf (same encoding as DOBFS)
+ - g must be the updated graph (Builder::ApplyUpdates of the old graph)
+ - Deleting a tree edge invalidates the subtree below it, which is found by
+   following tree edges in g. Each invalidated vertex restarts from the best
+   distance offered by an in-neighbor outside the invalidated subtrees.
+ - Inserted edges are relaxed, and then every vertex whose distance changed
+   is relaxed from a MultiQueue (as in MultiQueueSSSP) until none improve
+ - Parents of changed vertices are picked last from in-neighbors on a
+   shortest path, so they always agree with the final distances
+*/
+
+
+inline NodeID EdgeTarget(NodeID v) { return v; }
+inline NodeID EdgeTarget(WNode wn) { return wn.v; }
+
+inline WeightT EdgeLength(NodeID) { return 1; }
+inline WeightT EdgeLength(WNode wn) { return wn.w; }
+
+
+// In-neighbor of v on a shortest path to it, -1 if there is none
+template <typename GraphT_>
+NodeID TightParent(const GraphT_ &g, NodeID v, const pvector<WeightT> &dist) {
+  for (auto wn : g.in_neigh(v)) {
+    NodeID u = EdgeTarget(wn);
+    if ((dist[u] != kDistInf) && (dist[u] + EdgeLength(wn) == dist[v]))
+      return u;
+  }
+  return -1;
+}
+
+
+// Shortest-path tree for distances from a search that doesn't keep parents
+template <typename GraphT_>
+pvector<NodeID> ParentsFromDistances(const GraphT_ &g, NodeID source,
+                                     const pvector<WeightT> &dist) {
+  pvector<NodeID> parent(g.num_nodes());
+  #pragma omp parallel for schedule(dynamic, 1024)
+  for (NodeID v=0; v < g.num_nodes(); v++)
+    parent[v] = dist[v] == kDistInf ? -1 : TightParent(g, v, dist);
+  parent[source] = source;
+  return parent;
+}
+
+
+// Invalidates v if tree edge (u, v) was deleted
+inline
+void CutTreeEdge(NodeID u, NodeID v, pvector<WeightT> &dist,
+                 pvector<NodeID> &parent, Bitmap &changed,
+                 QueueBuffer<NodeID> &invalid) {
+  if ((parent[v] == u) && compare_and_swap(parent[v], u, -1)) {
+    dist[v] = kDistInf;
+    changed.set_bit_atomic(v);
+    invalid.push_back(v);
+  }
+}
+
+
+template <typename GraphT_, typename DestID_>
+void RepairPaths(const GraphT_ &g, const UpdateBatch<NodeID, DestID_> &batch,
+                 pvector<WeightT> &dist, pvector<NodeID> &parent,
+                 bool logging_enabled = true) {
+  Bitmap changed(g.num_nodes());
+  changed.reset();
+  // Invalidate subtrees below deleted tree edges, level by level
+  SlidingQueue<NodeID> invalid(g.num_nodes());
+  #pragma omp parallel
+  {
+    QueueBuffer<NodeID> linvalid(invalid);
+    #pragma omp for
+    for (size_t i=0; i < batch.deletions.size(); i++) {
+      NodeID u = batch.deletions[i].u;
+      NodeID v = EdgeTarget(batch.deletions[i].v);
+      CutTreeEdge(u, v, dist, parent, changed, linvalid);
+      if (!g.directed())
+        CutTreeEdge(v, u, dist, parent, changed, linvalid);
+    }
+    linvalid.flush();
+  }
+  invalid.slide_window();
+  int64_t num_invalidated = 0;
+  while (!invalid.empty()) {
+    num_invalidated += invalid.size();
+    #pragma omp parallel
+    {
+      QueueBuffer<NodeID> linvalid(invalid);
+      #pragma omp for schedule(dynamic, 64)
+      for (auto it = invalid.begin(); it < invalid.end(); it++) {
+        NodeID u = *it;
+        for (DestID_ wn : g.out_neigh(u))
+          CutTreeEdge(u, EdgeTarget(wn), dist, parent, changed, linvalid);
+      }
+      linvalid.flush();
+    }
+    invalid.slide_window();
+  }
+  // Restart invalidated vertices from valid in-neighbors (parent != -1, which
+  // is not written until the end), then relax inserted edges
+  MultiQueue<WeightT, NodeID> mq;
+  int64_t num_pending = 0;
+  #pragma omp parallel reduction(+ : num_pending)
+  {
+    #pragma omp for schedule(dynamic, 16)
+    for (size_t w=0; w < changed.num_words(); w++) {
+      changed.for_each_set_bit_in_word(w, [&](NodeID v) {
+        WeightT best = kDistInf;
+        for (DestID_ wn : g.in_neigh(v)) {
+          NodeID u = EdgeTarget(wn);
+          if ((parent[u] != -1) && (dist[u] + EdgeLength(wn) < best))
+            best = dist[u] + EdgeLength(wn);
+        }
+        dist[v] = best;
+        if (best != kDistInf) {
+          mq.push(best, v);
+          num_pending++;
+        }
+      });
+    }
+    auto Relax = [&](NodeID u, DestID_ wn) {
+      NodeID v = EdgeTarget(wn);
+      WeightT u_dist = dist[u];
+      if ((u_dist != kDistInf) &&
+          LowerDist(dist, v, u_dist + EdgeLength(wn))) {
+        changed.set_bit_atomic(v);
+        mq.push(u_dist + EdgeLength(wn), v);
+        num_pending++;
+      }
+    };
+    #pragma omp for
+    for (size_t i=0; i < batch.insertions.size(); i++) {
+      const EdgePair<NodeID, DestID_> &e = batch.insertions[i];
+      Relax(e.u, e.v);
+      if (!g.directed())
+        Relax(EdgeTarget(e.v),
+              BuilderBase<NodeID, DestID_, WeightT>::GetSource(e));
+    }
+  }
+  // Propagate changed distances with the same loop as MultiQueueSSSP
+  auto Propagate = [&](NodeID u, WeightT u_dist) {
+    int64_t num_pushed = 0;
+    for (DestID_ wn : g.out_neigh(u)) {
+      NodeID v = EdgeTarget(wn);
+      if (LowerDist(dist, v, u_dist + EdgeLength(wn))) {
+        changed.set_bit_atomic(v);
+        mq.push(u_dist + EdgeLength(wn), v);
+        num_pushed++;
+      }
+    }
+    return num_pushed;
+  };
+  int64_t num_pops = DrainMultiQueue(mq, num_pending, dist, Propagate);
+  #pragma omp parallel for schedule(dynamic, 16)
+  for (size_t w=0; w < changed.num_words(); w++) {
+    changed.for_each_set_bit_in_word(w, [&](NodeID v) {
+      parent[v] = dist[v] == kDistInf ? -1 : TightParent(g, v, dist);
+    });
+  }
+  if (logging_enabled) {
+    PrintStep("Invalidated", num_invalidated);
+    PrintStep("Changed", changed.count());
+    PrintStep("Pops", num_pops);
+  }
+}
+
+#endif  // PATH_REPAIR_H_
@@ -26,6 +26,22 @@ Wrappers for compiler intrinsics for atomic memory operations (AMOs)
       return __sync_fetch_and_add(&x, inc);
     }
 
+    // for polling a value other threads update with the operations here
+    template<typename T>
+    T load_acquire(const T &x) {
+      return __atomic_load_n(&x, __ATOMIC_ACQUIRE);
+    }
+
+    template<typename T, typename U>
+    T fetch_and_or(T &x, U bits) {
+      return __sync_fetch_and_or(&x, bits);
+    }
+
+    template<typename T, typename U>
+    T fetch_and_and(T &x, U bits) {
+      return __sync_fetch_and_and(&x, bits);
+    }
+
     template<typename T>
     bool compare_and_swap(T &x, const T &old_val, const T &new_val) {
       return __sync_bool_compare_and_swap(&x, old_val, new_val);
@@ -70,6 +86,13 @@ Wrappers for compiler intrinsics for atomic memory operations (AMOs)
       return atomic_add_64_nv((volatile uint64_t*) &x, inc) - inc;
     }
 
+    template<typename T>
+    T load_acquire(const T &x) {
+      T val = *((const volatile T*) &x);
+      membar_consumer();
+      return val;
+    }
+
     bool compare_and_swap(int32_t &x, const int32_t &old_val, const int32_t &new_val) {
       return old_val == atomic_cas_32((volatile uint32_t*) &x, old_val, new_val);
     }
@@ -98,6 +121,28 @@ Wrappers for compiler intrinsics for atomic memory operations (AMOs)
                                       (const volatile uint64_t&) new_val);
     }
 
+    template<typename T>
+    bool compare_and_swap(T* &x, T* const &old_val, T* const &new_val) {
+      return old_val == atomic_cas_ptr((volatile void*) &x, old_val, new_val);
+    }
+
+    // atomic_or_64_nv only returns the new value, so build from CAS
+    uint64_t fetch_and_or(uint64_t &x, uint64_t bits) {
+      uint64_t old_val;
+      do {
+        old_val = x;
+      } while (!compare_and_swap(x, old_val, old_val | bits));
+      return old_val;
+    }
+
+    uint64_t fetch_and_and(uint64_t &x, uint64_t bits) {
+      uint64_t old_val;
+      do {
+        old_val = x;
+      } while (!compare_and_swap(x, old_val, old_val & bits));
+      return old_val;
+    }
+
   #else   // defined __GNUC__ __SUNPRO_CC
 
     #error No atomics available for this compiler but using OpenMP
@@ -115,6 +160,25 @@ Wrappers for compiler intrinsics for atomic memory operations (AMOs)
     return orig_val;
   }
 
+  template<typename T>
+  T load_acquire(const T &x) {
+    return x;
+  }
+
+  template<typename T, typename U>
+  T fetch_and_or(T &x, U bits) {
+    T orig_val = x;
+    x |= bits;
+    return orig_val;
+  }
+
+  template<typename T, typename U>
+  T fetch_and_and(T &x, U bits) {
+    T orig_val = x;
+    x &= bits;
+    return orig_val;
+  }
+
   template<typename T>
   bool compare_and_swap(T &x, const T &old_val, const T &new_val) {
     if (x == old_val) {
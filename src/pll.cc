@@ -0,0 +1,544 @@
+// Copyright (c) 2015, The Regents of the University of California (Regents)
+// See LICENSE.txt for license details
+
+#include <algorithm>
+#include <cinttypes>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "benchmark.h"
+#include "builder.h"
+#include "command_line.h"
+#include "graph.h"
+#include "pvector.h"
+#include "timer.h"
+
+
+/*
+GAP Benchmark Suite
+Kernel: Pruned Landmark Labeling (PLL)
+
+Returns exact hop distances for a batch of source-target pairs
+
+Builds a 2-hop labeling [1] of an undirected graph: every vertex v gets a label
+of (hub, d(hub, v)) pairs such that for any pair u, v some shortest path passes
+through a hub they share, so d(u, v) is the smallest d(u, h) + d(h, v) over
+their common hubs. Queries are then a merge of two sorted labels and never
+touch the graph.
+
+The labels are built by BFS from every vertex in order of decreasing degree
+(Builder::RelabelByDegree makes that order the vertex IDs). A search from root
+r adds r to the label of each vertex it reaches, except that it is pruned at
+any vertex whose distance from r is already answered by the labels so far.
+High-degree vertices cover most shortest paths, so later searches are cut off
+quickly and labels stay small.
+
+Bit-parallel labels [1] are built first from a few high-degree roots. Each one
+also picks up to 64 of its neighbors, and one BFS records for every vertex the
+distance to the root along with two bitmasks of which of those neighbors are
+one closer or just as close. This covers 65 hubs per vertex in 17 bytes, and
+those bounds prune the remaining searches too.
+
+To build in parallel, roots are processed in batches whose searches run
+concurrently, only pruning with labels from earlier batches, and whose label
+entries are appended between batches. Pruning with fewer labels can only add
+redundant entries, so distances stay exact. Batches start at one root (the
+highest-degree roots prune the most) and grow as roots get less important.
+Labels can be saved (-o) and loaded (-i), and queries can come from a file (-Q)
+using the original vertex IDs, with the answers printed with -a.
+
+[1] Takuya Akiba, Yoichi Iwata, and Yuichi Yoshida. "Fast exact shortest-path
+    distance queries on large networks by pruned landmark labeling." ACM
+    SIGMOD International Conference on Management of Data, pages 349-360, 2013.
+*/
+
+
+using namespace std;
+
+typedef uint8_t LabelDist;
+const LabelDist kLabelInf = numeric_limits<LabelDist>::max();
+const int kBPNeighbors = 64;
+const NodeID kMaxBatchSize = 1024;
+const NodeID kBatchGrowth = 16;
+
+
+struct PLLIndex {
+  int64_t num_nodes;
+  int64_t num_edges;
+  int64_t num_bp_roots;
+  vector<LabelDist> bp_dist;    // [v*num_bp_roots + i] = d(root_i, v)
+  vector<uint64_t> bp_sets;     // [2*(v*num_bp_roots + i) + {0,1}] = S-1, S0
+  vector<int64_t> offsets;      // label of v is [offsets[v], offsets[v+1])
+  vector<NodeID> hubs;          // sorted within each label
+  vector<LabelDist> dists;
+
+  // Upper bound on d(u, v) from bit-parallel labels, exact if path through
+  // a root or one of its chosen neighbors is shortest
+  int BitParallelBound(NodeID u, NodeID v) const {
+    int best = numeric_limits<int>::max();
+    for (int64_t i=0; i < num_bp_roots; i++) {
+      LabelDist du = bp_dist[u*num_bp_roots + i];
+      LabelDist dv = bp_dist[v*num_bp_roots + i];
+      if ((du == kLabelInf) || (dv == kLabelInf))
+        continue;
+      int td = du + dv;
+      if (td - 2 < best) {
+        const uint64_t *su = &bp_sets[2*(u*num_bp_roots + i)];
+        const uint64_t *sv = &bp_sets[2*(v*num_bp_roots + i)];
+        if (su[0] & sv[0])
+          td -= 2;
+        else if ((su[0] & sv[1]) | (su[1] & sv[0]))
+          td -= 1;
+        best = min(best, td);
+      }
+    }
+    return best;
+  }
+
+  // Hop distance between u and v, -1 if not connected
+  NodeID Query(NodeID u, NodeID v) const {
+    int best = BitParallelBound(u, v);
+    int64_t i = offsets[u], j = offsets[v];
+    while ((i < offsets[u+1]) && (j < offsets[v+1])) {
+      if (hubs[i] == hubs[j]) {
+        best = min(best, dists[i] + dists[j]);
+        i++;
+        j++;
+      } else if (hubs[i] < hubs[j]) {
+        i++;
+      } else {
+        j++;
+      }
+    }
+    return best == numeric_limits<int>::max() ? -1 : best;
+  }
+};
+
+
+// Picks roots and their neighbor sets serially, then runs their BFSs in
+// parallel since each only writes its own column
+void BuildBitParallelLabels(const Graph &g, int num_bp_roots,
+                            PLLIndex &index) {
+  vector<bool> used(g.num_nodes(), false);
+  vector<NodeID> roots;
+  vector<vector<NodeID>> root_neighs;
+  NodeID next_root = 0;
+  while ((static_cast<int>(roots.size()) < num_bp_roots) &&
+         (next_root < g.num_nodes())) {
+    NodeID r = next_root++;
+    if (used[r] || (g.out_degree(r) == 0))
+      continue;
+    used[r] = true;
+    roots.push_back(r);
+    root_neighs.push_back(vector<NodeID>());
+    for (NodeID v : g.out_neigh(r)) {
+      if (!used[v]) {
+        used[v] = true;
+        root_neighs.back().push_back(v);
+        if (root_neighs.back().size() == kBPNeighbors)
+          break;
+      }
+    }
+  }
+  index.num_bp_roots = roots.size();
+  index.bp_dist.resize(g.num_nodes() * index.num_bp_roots);
+  index.bp_sets.resize(2 * g.num_nodes() * index.num_bp_roots);
+  #pragma omp parallel
+  {
+    pvector<LabelDist> depth(g.num_nodes());
+    pvector<pair<uint64_t, uint64_t>> sets(g.num_nodes());
+    vector<NodeID> queue;
+    vector<pair<NodeID, NodeID>> sibling_edges, child_edges;
+    #pragma omp for schedule(dynamic, 1)
+    for (int64_t i=0; i < index.num_bp_roots; i++) {
+      depth.fill(kLabelInf);
+      sets.fill(make_pair(0, 0));
+      queue.clear();
+      queue.push_back(roots[i]);
+      depth[roots[i]] = 0;
+      for (size_t n=0; n < root_neighs[i].size(); n++) {
+        NodeID v = root_neighs[i][n];
+        queue.push_back(v);
+        depth[v] = 1;
+        sets[v].first = static_cast<uint64_t>(1) << n;
+      }
+      size_t level_start = 0, level_end = 1;
+      for (int d=0; level_start < queue.size(); d++) {
+        if (d + 1 == kLabelInf) {
+          cout << "Graph diameter too large for labels" << endl;
+          exit(-30);
+        }
+        sibling_edges.clear();
+        child_edges.clear();
+        for (size_t q=level_start; q < level_end; q++) {
+          NodeID v = queue[q];
+          for (NodeID w : g.out_neigh(v)) {
+            if (depth[w] == d) {
+              if (v < w)
+                sibling_edges.push_back(make_pair(v, w));
+            } else if (depth[w] > d) {
+              if (depth[w] == kLabelInf) {
+                depth[w] = d + 1;
+                queue.push_back(w);
+              }
+              child_edges.push_back(make_pair(v, w));
+            }
+          }
+        }
+        for (auto e : sibling_edges) {
+          sets[e.first].second |= sets[e.second].first;
+          sets[e.second].second |= sets[e.first].first;
+        }
+        for (auto e : child_edges) {
+          sets[e.second].first |= sets[e.first].first;
+          sets[e.second].second |= sets[e.first].second;
+        }
+        level_start = level_end;
+        level_end = queue.size();
+      }
+      for (NodeID v=0; v < g.num_nodes(); v++) {
+        int64_t pos = v * index.num_bp_roots + i;
+        index.bp_dist[pos] = depth[v];
+        index.bp_sets[2*pos] = sets[v].first;
+        index.bp_sets[2*pos + 1] = sets[v].second;
+      }
+    }
+  }
+}
+
+
+struct LabelEntry {
+  NodeID v;
+  NodeID hub;
+  LabelDist d;
+};
+
+// Per-thread state for pruned searches
+struct SearchState {
+  pvector<LabelDist> root_dist;  // expanded label of current root by hub
+  pvector<LabelDist> depth;
+  vector<NodeID> queue;
+  vector<LabelEntry> found;
+  explicit SearchState(int64_t num_nodes)
+      : root_dist(num_nodes, kLabelInf), depth(num_nodes, kLabelInf) {}
+};
+
+
+void PrunedBFS(const Graph &g, NodeID r, const PLLIndex &index,
+               const vector<vector<pair<NodeID, LabelDist>>> &labels,
+               SearchState &state) {
+  for (auto hd : labels[r])
+    state.root_dist[hd.first] = hd.second;
+  state.queue.clear();
+  state.queue.push_back(r);
+  state.depth[r] = 0;
+  for (size_t q=0; q < state.queue.size(); q++) {
+    NodeID v = state.queue[q];
+    LabelDist d = state.depth[v];
+    if (index.BitParallelBound(r, v) <= d)
+      continue;
+    bool covered = false;
+    for (auto hd : labels[v]) {
+      LabelDist via_hub = state.root_dist[hd.first];
+      if ((via_hub != kLabelInf) && (via_hub + hd.second <= d)) {
+        covered = true;
+        break;
+      }
+    }
+    if (covered)
+      continue;
+    state.found.push_back(LabelEntry{v, r, d});
+    if (d + 1 == kLabelInf) {
+      cout << "Graph diameter too large for labels" << endl;
+      exit(-30);
+    }
+    for (NodeID w : g.out_neigh(v)) {
+      if (state.depth[w] == kLabelInf) {
+        state.depth[w] = d + 1;
+        state.queue.push_back(w);
+      }
+    }
+  }
+  for (NodeID v : state.queue)
+    state.depth[v] = kLabelInf;
+  for (auto hd : labels[r])
+    state.root_dist[hd.first] = kLabelInf;
+}
+
+
+PLLIndex BuildIndex(const Graph &g, int num_bp_roots) {
+  Timer t;
+  t.Start();
+  PLLIndex index;
+  index.num_nodes = g.num_nodes();
+  index.num_edges = g.num_edges();
+  BuildBitParallelLabels(g, num_bp_roots, index);
+  vector<vector<pair<NodeID, LabelDist>>> labels(g.num_nodes());
+  NodeID next_root = 0;
+  #pragma omp parallel
+  {
+    SearchState state(g.num_nodes());
+    while (next_root < g.num_nodes()) {
+      NodeID batch_start = next_root;
+      NodeID batch_size = min(kMaxBatchSize,
+                              max(static_cast<NodeID>(1),
+                                  batch_start / kBatchGrowth));
+      NodeID batch_end = min(static_cast<NodeID>(g.num_nodes()),
+                             batch_start + batch_size);
+      #pragma omp for schedule(dynamic, 1)
+      for (NodeID r=batch_start; r < batch_end; r++)
+        PrunedBFS(g, r, index, labels, state);
+      #pragma omp critical
+      {
+        for (const LabelEntry &e : state.found)
+          labels[e.v].push_back(make_pair(e.hub, e.d));
+      }
+      state.found.clear();
+      #pragma omp barrier
+      #pragma omp single
+      next_root = batch_end;
+    }
+  }
+  // Flatten into sorted arrays
+  index.offsets.resize(g.num_nodes() + 1);
+  index.offsets[0] = 0;
+  for (NodeID v=0; v < g.num_nodes(); v++)
+    index.offsets[v+1] = index.offsets[v] + labels[v].size();
+  index.hubs.resize(index.offsets[g.num_nodes()]);
+  index.dists.resize(index.offsets[g.num_nodes()]);
+  #pragma omp parallel for schedule(dynamic, 1024)
+  for (NodeID v=0; v < g.num_nodes(); v++) {
+    sort(labels[v].begin(), labels[v].end());
+    for (size_t i=0; i < labels[v].size(); i++) {
+      index.hubs[index.offsets[v] + i] = labels[v][i].first;
+      index.dists[index.offsets[v] + i] = labels[v][i].second;
+    }
+    vector<pair<NodeID, LabelDist>>().swap(labels[v]);
+  }
+  t.Stop();
+  PrintTime("Index Build Time", t.Seconds());
+  return index;
+}
+
+
+void PrintIndexStats(const PLLIndex &index) {
+  size_t max_label = 0;
+  for (int64_t v=0; v < index.num_nodes; v++)
+    max_label = max(max_label,
+                    static_cast<size_t>(index.offsets[v+1] - index.offsets[v]));
+  double avg_label = static_cast<double>(index.hubs.size()) / index.num_nodes;
+  PrintStep("Bit-Parallel Roots", index.num_bp_roots);
+  PrintLabel("Avg Label Size", to_string(avg_label));
+  PrintStep("Max Label Size", static_cast<int64_t>(max_label));
+  int64_t index_bytes = index.bp_dist.size() * sizeof(LabelDist);
+  index_bytes += index.bp_sets.size() * sizeof(uint64_t);
+  index_bytes += index.offsets.size() * sizeof(int64_t);
+  index_bytes += index.hubs.size() * (sizeof(NodeID) + sizeof(LabelDist));
+  PrintStep("Index Bytes", index_bytes);
+}
+
+
+// Writes index as raw binary, fields in order of PLLIndex
+void SaveIndex(const PLLIndex &index, string filename) {
+  fstream out(filename, ios::out | ios::binary);
+  if (!out) {
+    cout << "Couldn't write to file " << filename << endl;
+    exit(-5);
+  }
+  int64_t num_entries = index.hubs.size();
+  out.write(reinterpret_cast<const char*>(&index.num_nodes), sizeof(int64_t));
+  out.write(reinterpret_cast<const char*>(&index.num_edges), sizeof(int64_t));
+  out.write(reinterpret_cast<const char*>(&index.num_bp_roots),
+            sizeof(int64_t));
+  out.write(reinterpret_cast<const char*>(&num_entries), sizeof(int64_t));
+  out.write(reinterpret_cast<const char*>(index.bp_dist.data()),
+            index.bp_dist.size() * sizeof(LabelDist));
+  out.write(reinterpret_cast<const char*>(index.bp_sets.data()),
+            index.bp_sets.size() * sizeof(uint64_t));
+  out.write(reinterpret_cast<const char*>(index.offsets.data()),
+            index.offsets.size() * sizeof(int64_t));
+  out.write(reinterpret_cast<const char*>(index.hubs.data()),
+            num_entries * sizeof(NodeID));
+  out.write(reinterpret_cast<const char*>(index.dists.data()),
+            num_entries * sizeof(LabelDist));
+}
+
+
+PLLIndex LoadIndex(const Graph &g, string filename) {
+  Timer t;
+  t.Start();
+  fstream in(filename, ios::in | ios::binary);
+  if (!in) {
+    cout << "Couldn't open file " << filename << endl;
+    exit(-2);
+  }
+  PLLIndex index;
+  int64_t num_entries;
+  in.read(reinterpret_cast<char*>(&index.num_nodes), sizeof(int64_t));
+  in.read(reinterpret_cast<char*>(&index.num_edges), sizeof(int64_t));
+  in.read(reinterpret_cast<char*>(&index.num_bp_roots), sizeof(int64_t));
+  in.read(reinterpret_cast<char*>(&num_entries), sizeof(int64_t));
+  if (!in || (index.num_nodes != g.num_nodes()) ||
+      (index.num_edges != g.num_edges())) {
+    cout << "Labels in " << filename << " do not match graph" << endl;
+    exit(-20);
+  }
+  index.bp_dist.resize(index.num_nodes * index.num_bp_roots);
+  index.bp_sets.resize(2 * index.num_nodes * index.num_bp_roots);
+  index.offsets.resize(index.num_nodes + 1);
+  index.hubs.resize(num_entries);
+  index.dists.resize(num_entries);
+  in.read(reinterpret_cast<char*>(index.bp_dist.data()),
+          index.bp_dist.size() * sizeof(LabelDist));
+  in.read(reinterpret_cast<char*>(index.bp_sets.data()),
+          index.bp_sets.size() * sizeof(uint64_t));
+  in.read(reinterpret_cast<char*>(index.offsets.data()),
+          index.offsets.size() * sizeof(int64_t));
+  in.read(reinterpret_cast<char*>(index.hubs.data()),
+          num_entries * sizeof(NodeID));
+  in.read(reinterpret_cast<char*>(index.dists.data()),
+          num_entries * sizeof(LabelDist));
+  if (!in) {
+    cout << "Labels in " << filename << " are truncated" << endl;
+    exit(-20);
+  }
+  t.Stop();
+  PrintTime("Index Load Time", t.Seconds());
+  return index;
+}
+
+
+// Reads "u v" pairs (original IDs), returns them in relabeled IDs
+vector<pair<NodeID, NodeID>> ReadQueries(string filename,
+                                         const pvector<NodeID> &new_ids) {
+  ifstream in(filename);
+  if (!in) {
+    cout << "Couldn't open file " << filename << endl;
+    exit(-2);
+  }
+  vector<pair<NodeID, NodeID>> queries;
+  int64_t u, v;
+  while (in >> u >> v) {
+    if ((u < 0) || (v < 0) || (u >= static_cast<int64_t>(new_ids.size())) ||
+        (v >= static_cast<int64_t>(new_ids.size()))) {
+      cout << "Query " << u << " " << v << " is out of range" << endl;
+      exit(-21);
+    }
+    queries.push_back(make_pair(new_ids[u], new_ids[v]));
+  }
+  return queries;
+}
+
+
+pvector<NodeID> RunQueries(const PLLIndex &index,
+                           const vector<pair<NodeID, NodeID>> &queries) {
+  pvector<NodeID> answers(queries.size());
+  #pragma omp parallel for schedule(dynamic, 64)
+  for (size_t q=0; q < queries.size(); q++)
+    answers[q] = index.Query(queries[q].first, queries[q].second);
+  return answers;
+}
+
+
+void PrintPLLStats(const pvector<NodeID> &answers) {
+  int64_t num_connected = 0, total_dist = 0;
+  for (NodeID d : answers) {
+    if (d != -1) {
+      num_connected++;
+      total_dist += d;
+    }
+  }
+  cout << num_connected << " of " << answers.size() << " queries connected";
+  if (num_connected != 0)
+    cout << " with avg distance " << 1.0 * total_dist / num_connected;
+  cout << endl;
+}
+
+
+// Compares against serial BFS from each query's source
+bool PLLVerifier(const Graph &g, const vector<pair<NodeID, NodeID>> &queries,
+                 const pvector<NodeID> &answers) {
+  pvector<NodeID> depth(g.num_nodes(), -1);
+  vector<NodeID> to_visit;
+  bool all_ok = true;
+  for (size_t q=0; q < queries.size(); q++) {
+    NodeID source = queries[q].first;
+    NodeID target = queries[q].second;
+    to_visit.clear();
+    to_visit.push_back(source);
+    depth[source] = 0;
+    for (size_t i=0; (i < to_visit.size()) && (depth[target] == -1); i++) {
+      NodeID u = to_visit[i];
+      for (NodeID v : g.out_neigh(u)) {
+        if (depth[v] == -1) {
+          depth[v] = depth[u] + 1;
+          to_visit.push_back(v);
+        }
+      }
+    }
+    if (answers[q] != depth[target]) {
+      cout << source << " -> " << target << ": " << answers[q] << " != "
+           << depth[target] << endl;
+      all_ok = false;
+    }
+    for (NodeID v : to_visit)
+      depth[v] = -1;
+  }
+  return all_ok;
+}
+
+
+int main(int argc, char* argv[]) {
+  CLPLL cli(argc, argv, "pruned landmark labeling");
+  if (!cli.ParseArgs())
+    return -1;
+  Builder b(cli);
+  pvector<NodeID> new_ids;
+  Graph g = Builder::RelabelByDegree(b.MakeGraph(), &new_ids);
+  PLLIndex index;
+  if (cli.index_in() != "")
+    index = LoadIndex(g, cli.index_in());
+  else
+    index = BuildIndex(g, cli.num_bp_roots());
+  PrintIndexStats(index);
+  if (cli.index_out() != "")
+    SaveIndex(index, cli.index_out());
+  vector<pair<NodeID, NodeID>> queries;
+  if (cli.query_file() != "") {
+    queries = ReadQueries(cli.query_file(), new_ids);
+  } else {
+    SourcePicker<Graph> sp(g);
+    for (int q=0; q < cli.num_queries(); q++) {
+      NodeID source = sp.PickNext();
+      queries.push_back(make_pair(source, sp.PickNext()));
+    }
+  }
+  auto PLLBound = [&index, &queries] (const Graph &g) {
+    return RunQueries(index, queries);
+  };
+  // with a query file, analysis (-a) prints each answer in original IDs
+  pvector<NodeID> old_ids(g.num_nodes());
+  #pragma omp parallel for
+  for (NodeID v=0; v < g.num_nodes(); v++)
+    old_ids[new_ids[v]] = v;
+  bool print_answers = cli.query_file() != "";
+  auto StatsBound = [&queries, &old_ids, print_answers] (
+      const Graph &g, const pvector<NodeID> &answers) {
+    PrintPLLStats(answers);
+    if (print_answers) {
+      for (size_t q=0; q < queries.size(); q++)
+        cout << old_ids[queries[q].first] << " "
+             << old_ids[queries[q].second] << " " << answers[q] << endl;
+    }
+  };
+  auto VerifierBound = [&queries] (const Graph &g,
+                                   const pvector<NodeID> &answers) {
+    return PLLVerifier(g, queries, answers);
+  };
+  BenchmarkKernel(cli, g, PLLBound, StatsBound, VerifierBound);
+  return 0;
+}
@@ -0,0 +1,94 @@
+// Copyright (c) 2015, The Regents of the University of California (Regents)
+// See LICENSE.txt for license details
+
+#ifndef PR_H_
+#define PR_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+#include "benchmark.h"
+#include "graph.h"
+#include "pvector.h"
+
+
+/*
+GAP Benchmark Suite
+File:   PageRank
+
+PageRank (PR) over a Graph by pull iterations, its stats, and its verifier
+ - PageRankPull is described with the pr kernel (pr.cc)
+ - Shared so other kernels (e.g. pr_inc starting from converged scores and
+   checking against a full recompute) use the same scores pr does
+*/
+
+
+typedef float ScoreT;
+const float kDamp = 0.85;
+
+pvector<ScoreT> PageRankPull(const Graph &g, int max_iters,
+                             double epsilon = 0) {
+  const ScoreT init_score = 1.0f / g.num_nodes();
+  const ScoreT base_score = (1.0f - kDamp) / g.num_nodes();
+  pvector<ScoreT> scores(g.num_nodes(), init_score);
+  pvector<ScoreT> outgoing_contrib(g.num_nodes());
+  for (int iter=0; iter < max_iters; iter++) {
+    double error = 0;
+    #pragma omp parallel for
+    for (NodeID n=0; n < g.num_nodes(); n++)
+      outgoing_contrib[n] = scores[n] / g.out_degree(n);
+    #pragma omp parallel for reduction(+ : error) schedule(dynamic, 64)
+    for (NodeID u=0; u < g.num_nodes(); u++) {
+      ScoreT incoming_total = 0;
+      for (NodeID v : g.in_neigh(u))
+        incoming_total += outgoing_contrib[v];
+      ScoreT old_score = scores[u];
+      scores[u] = base_score + kDamp * incoming_total;
+      error += std::fabs(scores[u] - old_score);
+    }
+    printf(" %2d    %lf\n", iter, error);
+    if (error < epsilon)
+      break;
+  }
+  return scores;
+}
+
+
+void PrintTopScores(const Graph &g, const pvector<ScoreT> &scores) {
+  std::vector<std::pair<NodeID, ScoreT>> score_pairs(g.num_nodes());
+  for (NodeID n=0; n < g.num_nodes(); n++) {
+    score_pairs[n] = std::make_pair(n, scores[n]);
+  }
+  int k = 5;
+  std::vector<std::pair<ScoreT, NodeID>> top_k = TopK(score_pairs, k);
+  k = std::min(k, static_cast<int>(top_k.size()));
+  for (auto kvp : top_k)
+    std::cout << kvp.second << ":" << kvp.first << std::endl;
+}
+
+
+// Verifies by asserting a single serial iteration in push direction has
+//   error < target_error
+bool PRVerifier(const Graph &g, const pvector<ScoreT> &scores,
+                        double target_error) {
+  const ScoreT base_score = (1.0f - kDamp) / g.num_nodes();
+  pvector<ScoreT> incomming_sums(g.num_nodes(), 0);
+  double error = 0;
+  for (NodeID u : g.vertices()) {
+    ScoreT outgoing_contrib = scores[u] / g.out_degree(u);
+    for (NodeID v : g.out_neigh(u))
+      incomming_sums[v] += outgoing_contrib;
+  }
+  for (NodeID n : g.vertices()) {
+    error += std::fabs(base_score + kDamp * incomming_sums[n] - scores[n]);
+    incomming_sums[n] = 0;
+  }
+  PrintTime("Total Error", error);
+  return error < target_error;
+}
+
+#endif  // PR_H_
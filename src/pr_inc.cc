@@ -0,0 +1,288 @@
+// Copyright (c) 2015, The Regents of the University of California (Regents)
+// See LICENSE.txt for license details
+
+#include <algorithm>
+#include <cinttypes>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include "benchmark.h"
+#include "bitmap.h"
+#include "builder.h"
+#include "command_line.h"
+#include "dynamic_graph.h"
+#include "edge_update.h"
+#include "graph.h"
+#include "platform_atomics.h"
+#include "pr.h"
+#include "pvector.h"
+#include "timer.h"
+
+
+/*
+GAP Benchmark Suite
+Kernel: Incremental PageRank (PR)
+
+Will return pagerank scores for all vertices, kept within tolerance of the
+fixed point over a stream of edge updates
+
+Before the trials, the scores of the input graph are found by PageRankPull
+(pr.h), and a batch of random edge updates (-b updates, -p percent of them
+deletions, from UpdateGenerator) is generated for each trial. Each trial
+applies its batch to a DynamicGraph of the input graph and updates the scores
+from where the previous trial left them, so the trial time is the latency of
+a batch.
+
+Alongside the scores, it keeps each vertex's residual (how much one more pull
+iteration would change its score) and their total, which is the error
+PRVerifier measures. Only vertices whose out-neighborhood changed send
+different contributions, so a batch moves their old contributions out of the
+residuals of their old out-neighbors and their new contributions into those of
+their new ones. If that leaves the total residual over half the tolerance,
+residuals are pushed from the vertices whose residuals were touched, largest
+first: a pushed vertex adds its residual to its score and passes the damped
+share of it on to its out-neighbors' residuals. Each round pushes residuals
+over a threshold that halves every round, until the total is back under half
+the tolerance. If the touched vertices grow to a large part of the graph
+(as they do as soon as a hub's neighborhood changes), pushing is abandoned for
+pull iterations over every vertex (as PageRankPull) until the total is back
+under half the tolerance, or (also as PageRankPull) -i iterations are done.
+Either way, a batch small enough to leave the total under half the tolerance
+costs nothing more than moving its contributions.
+
+Each trial is checked by PRVerifier on the updated graph
+(DynamicGraph::Compact), and against PageRankPull rerun on it.
+*/
+
+
+using namespace std;
+
+typedef DynamicGraph<NodeID> DGraph;
+
+
+// Scores kept with their residuals, and the total (absolute) residual
+struct PageRankState {
+  pvector<ScoreT> scores;
+  pvector<ScoreT> residuals;
+  double error;
+};
+
+
+// Atomically adds inc to the residual r, returns change in its magnitude
+inline
+double AddResidual(ScoreT &r, ScoreT inc) {
+  ScoreT old_r = r;
+  while (!compare_and_swap(r, old_r, old_r + inc))
+    old_r = r;
+  return fabs(old_r + inc) - fabs(old_r);
+}
+
+
+// Atomically zeroes the residual r and returns what it was
+inline
+ScoreT TakeResidual(ScoreT &r) {
+  ScoreT old_r = r;
+  while (!compare_and_swap(r, old_r, 0.0f))
+    old_r = r;
+  return old_r;
+}
+
+
+// Sets each residual to how much one more pull iteration would change its
+// score, along with their total
+void ComputeResiduals(const DGraph &g, PageRankState &state) {
+  const ScoreT base_score = (1.0f - kDamp) / g.num_nodes();
+  pvector<ScoreT> outgoing_contrib(g.num_nodes());
+  #pragma omp parallel for
+  for (NodeID n=0; n < g.num_nodes(); n++)
+    outgoing_contrib[n] = state.scores[n] / g.out_degree(n);
+  double error = 0;
+  #pragma omp parallel for reduction(+ : error) schedule(dynamic, 64)
+  for (NodeID u=0; u < g.num_nodes(); u++) {
+    ScoreT incoming_total = 0;
+    for (NodeID v : g.in_neigh(u))
+      incoming_total += outgoing_contrib[v];
+    state.residuals[u] = base_score + kDamp * incoming_total -
+                         state.scores[u];
+    error += fabs(state.residuals[u]);
+  }
+  state.error = error;
+}
+
+
+// Pull iterations over every vertex (as in PageRankPull) until the total
+// residual is under target_error or max_iters are done, returns number of
+// iterations
+int PullResiduals(const DGraph &g, double target_error, int max_iters,
+                  PageRankState &state) {
+  int num_iters = 0;
+  while ((state.error >= target_error) && (num_iters < max_iters)) {
+    #pragma omp parallel for
+    for (NodeID n=0; n < g.num_nodes(); n++)
+      state.scores[n] += state.residuals[n];
+    ComputeResiduals(g, state);
+    num_iters++;
+  }
+  return num_iters;
+}
+
+
+// Adds sign times the contributions of the changed vertices to the residuals
+// of their out-neighbors, which are marked in touched
+void MoveContributions(const DGraph &g, const Bitmap &changed, ScoreT sign,
+                       PageRankState &state, Bitmap &touched) {
+  double error_change = 0;
+  #pragma omp parallel for reduction(+ : error_change) schedule(dynamic, 16)
+  for (size_t w=0; w < changed.num_words(); w++) {
+    changed.for_each_set_bit_in_word(w, [&](NodeID u) {
+      if (g.out_degree(u) == 0)
+        return;
+      ScoreT contrib = sign * kDamp * state.scores[u] / g.out_degree(u);
+      for (NodeID v : g.out_neigh(u)) {
+        error_change += AddResidual(state.residuals[v], contrib);
+        touched.set_bit_atomic(v);
+      }
+    });
+  }
+  state.error += error_change;
+}
+
+
+// Brings the total residual under target_error by pushing from the touched
+// vertices (described above), or by (at most max_iters) pull iterations once
+// they reach |V| / kPullFraction
+void PushResiduals(const DGraph &g, double target_error, int max_iters,
+                   PageRankState &state, Bitmap &touched,
+                   bool logging_enabled = true) {
+  const int64_t kPullFraction = 20;
+  const ScoreT min_threshold = target_error / g.num_nodes();
+  int64_t num_touched = touched.count();
+  ScoreT threshold = 0;
+  #pragma omp parallel for reduction(max : threshold)
+  for (size_t w=0; w < touched.num_words(); w++) {
+    touched.for_each_set_bit_in_word(w, [&](NodeID u) {
+      threshold = std::max(threshold, ScoreT(fabs(state.residuals[u])));
+    });
+  }
+  threshold /= 2;
+  int64_t num_pushes = 0;
+  while ((state.error >= target_error) &&
+         (num_touched < g.num_nodes() / kPullFraction) &&
+         (threshold > min_threshold)) {
+    double error_change = 0;
+    #pragma omp parallel for schedule(dynamic, 16) \
+        reduction(+ : num_pushes, num_touched, error_change)
+    for (size_t w=0; w < touched.num_words(); w++) {
+      touched.for_each_set_bit_in_word(w, [&](NodeID u) {
+        if (fabs(state.residuals[u]) <= threshold)
+          return;
+        ScoreT residual = TakeResidual(state.residuals[u]);
+        error_change -= fabs(residual);
+        state.scores[u] += residual;
+        num_pushes++;
+        if (g.out_degree(u) == 0)
+          return;
+        ScoreT contrib = kDamp * residual / g.out_degree(u);
+        for (NodeID v : g.out_neigh(u)) {
+          error_change += AddResidual(state.residuals[v], contrib);
+          if (touched.set_bit_atomic(v))
+            num_touched++;
+        }
+      });
+    }
+    state.error += error_change;
+    threshold /= 2;
+  }
+  int num_pulls = 0;
+  if (state.error >= target_error)
+    num_pulls = PullResiduals(g, target_error, max_iters, state);
+  if (logging_enabled) {
+    PrintStep("Pushes", num_pushes);
+    PrintStep("Pull Iterations", static_cast<int64_t>(num_pulls));
+  }
+}
+
+
+// Applies batch to g and updates state for it
+void UpdateScores(DGraph &g, const UpdateBatch<NodeID> &batch,
+                  double target_error, int max_iters, PageRankState &state,
+                  bool logging_enabled = true) {
+  Bitmap changed(g.num_nodes());
+  changed.reset();
+  for (const pvector<EdgePair<NodeID>> *edges :
+       {&batch.insertions, &batch.deletions}) {
+    #pragma omp parallel for
+    for (size_t i=0; i < edges->size(); i++) {
+      changed.set_bit_atomic((*edges)[i].u);
+      if (!g.directed())
+        changed.set_bit_atomic((*edges)[i].v);
+    }
+  }
+  Bitmap touched(g.num_nodes());
+  touched.reset();
+  MoveContributions(g, changed, -1, state, touched);
+  g.ApplyBatch(batch.insertions, batch.deletions);
+  MoveContributions(g, changed, 1, state, touched);
+  if (logging_enabled)
+    PrintStep("Changed", changed.count());
+  PushResiduals(g, target_error, max_iters, state, touched, logging_enabled);
+}
+
+
+// Sum of absolute differences between two score vectors
+double ScoreDistance(const pvector<ScoreT> &a, const pvector<ScoreT> &b) {
+  double distance = 0;
+  #pragma omp parallel for reduction(+ : distance)
+  for (size_t n=0; n < a.size(); n++)
+    distance += fabs(a[n] - b[n]);
+  return distance;
+}
+
+
+int main(int argc, char* argv[]) {
+  // pull iterations shrink a net change in total score only by kDamp each, so
+  // allow more of them than pr does
+  CLPageRankUpdate cli(argc, argv, "incremental pagerank", 1e-4, 100);
+  if (!cli.ParseArgs())
+    return -1;
+  Builder b(cli);
+  Graph g = b.MakeGraph();
+  UpdateGenerator<NodeID> updates(g, cli.batch_size(), cli.delete_percent());
+  vector<UpdateBatch<NodeID>> batches;
+  for (int i=0; i < cli.num_trials(); i++)
+    batches.push_back(updates.NextBatch());
+  DGraph dg(g);
+  // half, to leave room for rounding since residuals are updated in place
+  const double target_error = cli.tolerance() / 2;
+  Timer t;
+  t.Start();
+  PageRankState state;
+  state.scores = PageRankPull(g, cli.max_iters(), cli.tolerance());
+  state.residuals = pvector<ScoreT>(g.num_nodes());
+  ComputeResiduals(dg, state);
+  PullResiduals(dg, target_error, cli.max_iters(), state);
+  t.Stop();
+  PrintTime("Initial Time", t.Seconds());
+  size_t num_applied = 0;
+  auto UpdateBound = [&] (const DGraph &) {
+    UpdateScores(dg, batches[num_applied++], target_error, cli.max_iters(),
+                 state);
+    return &state.scores;
+  };
+  auto StatsBound = [] (const DGraph &dg, const pvector<ScoreT> *scores) {
+    PrintTopScores(dg.Compact(), *scores);
+  };
+  // How far apart two runs that each end with total residual under tolerance
+  // can be, as each is within tolerance / (1 - kDamp) of the fixed point
+  const double max_distance = 2 * cli.tolerance() / (1 - kDamp);
+  auto VerifierBound = [&cli, max_distance] (const DGraph &dg,
+                                             const pvector<ScoreT> *scores) {
+    Graph g = dg.Compact();
+    pvector<ScoreT> full = PageRankPull(g, cli.max_iters(), cli.tolerance());
+    return PRVerifier(g, *scores, cli.tolerance()) &&
+           (ScoreDistance(*scores, full) < max_distance);
+  };
+  BenchmarkKernel(cli, dg, UpdateBound, StatsBound, VerifierBound);
+  return 0;
+}
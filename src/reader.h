@@ -25,6 +25,7 @@ Given filename, returns an edgelist or the entire graph (if serialized)
  - If the input graph is serialized (.sg or .wsg), reads the graph
    directly into the returned graph instance
  - Otherwise, reads the file and returns an edgelist
+ - ReadFileChunks hands the edgelist over a chunk at a time instead
 */
 
 
@@ -66,6 +67,27 @@ class Reader {
     return el;
   }
 
+  // Reads pairs of a source and a DestT_ (the .el or .wel line format),
+  // handing them to process each time chunk_size of them have been read
+  template <typename DestT_, typename ChunkFunc>
+  void ReadInPairChunks(std::ifstream &in, ChunkFunc process,
+                        int64_t chunk_size) {
+    EdgeList el(chunk_size);
+    int64_t num_read = 0;
+    NodeID_ u;
+    DestT_ v;
+    while (in >> u >> v) {
+      el[num_read++] = Edge(u, v);
+      if (num_read == chunk_size) {
+        process(el);
+        num_read = 0;
+      }
+    }
+    el.resize(num_read);
+    if (num_read != 0)
+      process(el);
+  }
+
   // Note: converts vertex numbering from 1..N to 0..N-1
   EdgeList ReadInGR(std::ifstream &in) {
     EdgeList el;
@@ -249,6 +271,30 @@ class Reader {
     return el;
   }
 
+  // Hands the edgelist to process a chunk at a time while reading it, which
+  // only .el and .wel files support (others are read whole as one chunk)
+  template <typename ChunkFunc>
+  void ReadFileChunks(ChunkFunc process, int64_t chunk_size) {
+    std::string suffix = GetSuffix();
+    if ((suffix != ".el") && (suffix != ".wel")) {
+      bool needs_weights;
+      EdgeList el = ReadFile(needs_weights);
+      process(el);
+      return;
+    }
+    std::ifstream file(filename_);
+    if (!file.is_open()) {
+      std::cout << "Couldn't open file " << filename_ << std::endl;
+      std::exit(-2);
+    }
+    if (suffix == ".el")
+      ReadInPairChunks<NodeID_>(file, process, chunk_size);
+    else
+      ReadInPairChunks<NodeWeight<NodeID_, WeightT_>>(file, process,
+                                                      chunk_size);
+    file.close();
+  }
+
   CSRGraph<NodeID_, DestID_, invert> ReadSerializedGraph() {
     bool weighted = GetSuffix() == ".wsg";
     if (!std::is_same<NodeID_, SGID>::value) {
@@ -0,0 +1,404 @@
+// Copyright (c) 2015, The Regents of the University of California (Regents)
+// See LICENSE.txt for license details
+
+#include <algorithm>
+#include <cinttypes>
+#include <iostream>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "benchmark.h"
+#include "bfs.h"
+#include "bitmap.h"
+#include "builder.h"
+#include "command_line.h"
+#include "graph.h"
+#include "platform_atomics.h"
+#include "pvector.h"
+#include "sliding_queue.h"
+#include "timer.h"
+
+
+/*
+GAP Benchmark Suite
+Kernel: Strongly Connected Components (SCC)
+
+Will return comp array labelling each vertex with a strongly connected
+component ID: vertices can reach each other (following edge directions)
+exactly when they have the same ID
+
+For an undirected graph these are the connected components.
+
+This implementation takes the steps of Multistep [1]:
+  1) Trim: A vertex with no in-edges or no out-edges from vertices still
+     left is an SCC by itself. Such vertices are removed in rounds (like
+     peeling in kcore), decrementing the counts of their neighbors' edges
+     left, until no more can be removed.
+  2) Forward-backward: The SCC of a pivot is the vertices both reachable from
+     it and that reach it [2]. The pivot is the vertex left with the largest
+     product of in and out degrees, which is very likely in the giant SCC of a
+     real graph. Both searches are direction-optimizing BFS (DOBFS from bfs.h),
+     the backward one over the transpose.
+  3) Coloring: Every vertex left starts with its own ID as its color, and the
+     largest color is propagated along edges (in rounds, from the vertices
+     whose color changed) until no color changes [3]. A vertex whose color is
+     its own ID is then a root, and its SCC is the vertices of its color that
+     reach it, found by a search backwards from all roots at once. This
+     repeats over the vertices still left (kept in a queue, so each repeat
+     only visits them) until none are, and suits the many small SCCs left
+     after the first two steps.
+
+The verifier compares with the SCCs found by (serial) Tarjan [4].
+
+[1] George M. Slota, Sivasankaran Rajamanickam, and Kamesh Madduri. "BFS and
+    coloring-based parallel algorithms for strongly connected components and
+    related problems." International Parallel and Distributed Processing
+    Symposium (IPDPS), 2014.
+
+[2] Lisa K. Fleischer, Bruce Hendrickson, and Ali Pinar. "On identifying
+    strongly connected components in parallel." International Parallel and
+    Distributed Processing Symposium (IPDPS) Workshops, 2000.
+
+[3] Simona Orzan. "On distributed verification and verified distribution."
+    PhD thesis, Vrije Universiteit, 2004.
+
+[4] Robert Tarjan. "Depth-first search and linear graph algorithms." SIAM
+    Journal on Computing, 1972.
+*/
+
+
+using namespace std;
+
+const NodeID kNoComp = -1;
+
+
+// Removes vertices left with no in-edges or no out-edges, each as its own SCC,
+// and returns how many it removed
+int64_t Trim(const Graph &g, pvector<NodeID> &comp) {
+  pvector<NodeID> in_left(g.num_nodes());
+  pvector<NodeID> out_left(g.num_nodes());
+  Bitmap removed(g.num_nodes());
+  removed.reset();
+  SlidingQueue<NodeID> queue(g.num_nodes());
+  #pragma omp parallel
+  {
+    QueueBuffer<NodeID> lqueue(queue);
+    #pragma omp for nowait
+    for (NodeID u=0; u < g.num_nodes(); u++) {
+      in_left[u] = g.in_degree(u);
+      out_left[u] = g.out_degree(u);
+      if ((in_left[u] == 0) || (out_left[u] == 0)) {
+        removed.set_bit_atomic(u);
+        comp[u] = u;
+        lqueue.push_back(u);
+      }
+    }
+    lqueue.flush();
+  }
+  queue.slide_window();
+  int64_t num_removed = 0;
+  while (!queue.empty()) {
+    num_removed += queue.size();
+    #pragma omp parallel
+    {
+      QueueBuffer<NodeID> lqueue(queue);
+      #pragma omp for schedule(dynamic, 64) nowait
+      for (auto it = queue.begin(); it < queue.end(); it++) {
+        for (NodeID v : g.out_neigh(*it)) {
+          if (!removed.get_bit(v) && (fetch_and_add(in_left[v], -1) == 1) &&
+              removed.set_bit_atomic(v)) {
+            comp[v] = v;
+            lqueue.push_back(v);
+          }
+        }
+        for (NodeID v : g.in_neigh(*it)) {
+          if (!removed.get_bit(v) && (fetch_and_add(out_left[v], -1) == 1) &&
+              removed.set_bit_atomic(v)) {
+            comp[v] = v;
+            lqueue.push_back(v);
+          }
+        }
+      }
+      lqueue.flush();
+    }
+    queue.slide_window();
+  }
+  return num_removed;
+}
+
+
+// Labels the SCC of the vertex left with the most in-edges times out-edges
+// (backward is g transposed, or g itself if undirected) and returns its size
+int64_t ForwardBackward(const Graph &g, const Graph &backward,
+                        pvector<NodeID> &comp) {
+  int64_t max_product = -1;
+  #pragma omp parallel for reduction(max : max_product)
+  for (NodeID u=0; u < g.num_nodes(); u++) {
+    if (comp[u] == kNoComp)
+      max_product = max(max_product, g.in_degree(u) * g.out_degree(u));
+  }
+  if (max_product == -1)
+    return 0;
+  // lowest ID of those with the largest product, so runs pick the same pivot
+  NodeID pivot = g.num_nodes();
+  #pragma omp parallel for reduction(min : pivot)
+  for (NodeID u=0; u < g.num_nodes(); u++) {
+    if ((comp[u] == kNoComp) &&
+        (g.in_degree(u) * g.out_degree(u) == max_product))
+      pivot = min(pivot, u);
+  }
+  pvector<NodeID> forward_parent = DOBFS(g, pivot);
+  pvector<NodeID> backward_parent = DOBFS(backward, pivot);
+  int64_t num_labelled = 0;
+  #pragma omp parallel for reduction(+ : num_labelled)
+  for (NodeID u=0; u < g.num_nodes(); u++) {
+    if ((forward_parent[u] >= 0) && (backward_parent[u] >= 0)) {
+      comp[u] = pivot;
+      num_labelled++;
+    }
+  }
+  return num_labelled;
+}
+
+
+// Raises each unlabelled vertex (all listed in remaining) to the largest ID
+// of an unlabelled vertex that reaches it (through unlabelled vertices).
+// changed must start clear, and is left clear, since each round clears only
+// the bits of the vertices queued for it.
+void PropagateColors(const Graph &g, const pvector<NodeID> &comp,
+                     const SlidingQueue<NodeID> &remaining, Bitmap &changed,
+                     pvector<NodeID> &color) {
+  SlidingQueue<NodeID> queue_a(g.num_nodes());
+  SlidingQueue<NodeID> queue_b(g.num_nodes());
+  SlidingQueue<NodeID> *queue = &queue_a;
+  SlidingQueue<NodeID> *next_queue = &queue_b;
+  #pragma omp parallel
+  {
+    QueueBuffer<NodeID> lqueue(*queue);
+    #pragma omp for nowait
+    for (auto it = remaining.begin(); it < remaining.end(); it++) {
+      color[*it] = *it;
+      lqueue.push_back(*it);
+    }
+    lqueue.flush();
+  }
+  queue->slide_window();
+  while (!queue->empty()) {
+    #pragma omp parallel
+    {
+      #pragma omp for
+      for (auto it = queue->begin(); it < queue->end(); it++)
+        changed.clear_bit_atomic(*it);
+      QueueBuffer<NodeID> lqueue(*next_queue);
+      #pragma omp for schedule(dynamic, 64) nowait
+      for (auto it = queue->begin(); it < queue->end(); it++) {
+        NodeID u_color = color[*it];
+        for (NodeID v : g.out_neigh(*it)) {
+          if (comp[v] != kNoComp)
+            continue;
+          NodeID v_color = color[v];
+          while ((u_color > v_color) &&
+                 !compare_and_swap(color[v], v_color, u_color))
+            v_color = color[v];
+          if ((u_color > v_color) && !changed.get_bit(v) &&
+              changed.set_bit_atomic(v))
+            lqueue.push_back(v);
+        }
+      }
+      lqueue.flush();
+    }
+    next_queue->slide_window();
+    queue->reset();
+    swap(queue, next_queue);
+  }
+}
+
+
+// Labels the SCC of each root (unlabelled vertex whose color is its ID, all
+// listed in remaining) by searching backwards from all of them within their
+// colors
+void LabelColorRoots(const Graph &g, const pvector<NodeID> &color,
+                     const SlidingQueue<NodeID> &remaining,
+                     pvector<NodeID> &comp) {
+  SlidingQueue<NodeID> queue(g.num_nodes());
+  #pragma omp parallel
+  {
+    QueueBuffer<NodeID> lqueue(queue);
+    #pragma omp for nowait
+    for (auto it = remaining.begin(); it < remaining.end(); it++) {
+      if (color[*it] == *it)
+        lqueue.push_back(*it);
+    }
+    lqueue.flush();
+  }
+  queue.slide_window();
+  #pragma omp parallel for
+  for (auto it = queue.begin(); it < queue.end(); it++)
+    comp[*it] = *it;
+  while (!queue.empty()) {
+    #pragma omp parallel
+    {
+      QueueBuffer<NodeID> lqueue(queue);
+      #pragma omp for schedule(dynamic, 64) nowait
+      for (auto it = queue.begin(); it < queue.end(); it++) {
+        NodeID u_color = color[*it];
+        for (NodeID v : g.in_neigh(*it)) {
+          if ((comp[v] == kNoComp) && (color[v] == u_color) &&
+              compare_and_swap(comp[v], kNoComp, u_color))
+            lqueue.push_back(v);
+        }
+      }
+      lqueue.flush();
+    }
+    queue.slide_window();
+  }
+}
+
+
+pvector<NodeID> MultistepSCC(const Graph &g, const Graph &backward,
+                             bool logging_enabled = true) {
+  Timer t;
+  pvector<NodeID> comp(g.num_nodes(), kNoComp);
+  t.Start();
+  int64_t num_trimmed = Trim(g, comp);
+  t.Stop();
+  if (logging_enabled)
+    PrintStep("trim", t.Seconds(), num_trimmed);
+  t.Start();
+  int64_t pivot_size = ForwardBackward(g, backward, comp);
+  t.Stop();
+  if (logging_enabled)
+    PrintStep("fwbw", t.Seconds(), pivot_size);
+  // Vertices still unlabelled, which are filtered after each coloring step so
+  // later ones never scan all the vertices
+  SlidingQueue<NodeID> remaining_a(g.num_nodes());
+  SlidingQueue<NodeID> remaining_b(g.num_nodes());
+  SlidingQueue<NodeID> *remaining = &remaining_a;
+  SlidingQueue<NodeID> *survivors = &remaining_b;
+  #pragma omp parallel
+  {
+    QueueBuffer<NodeID> lremaining(*remaining);
+    #pragma omp for nowait
+    for (NodeID u=0; u < g.num_nodes(); u++) {
+      if (comp[u] == kNoComp)
+        lremaining.push_back(u);
+    }
+    lremaining.flush();
+  }
+  remaining->slide_window();
+  pvector<NodeID> color(g.num_nodes());
+  Bitmap changed(g.num_nodes());
+  changed.reset();
+  while (!remaining->empty()) {
+    t.Start();
+    PropagateColors(g, comp, *remaining, changed, color);
+    LabelColorRoots(g, color, *remaining, comp);
+    survivors->reset();
+    #pragma omp parallel
+    {
+      QueueBuffer<NodeID> lsurvivors(*survivors);
+      #pragma omp for nowait
+      for (auto it = remaining->begin(); it < remaining->end(); it++) {
+        if (comp[*it] == kNoComp)
+          lsurvivors.push_back(*it);
+      }
+      lsurvivors.flush();
+    }
+    survivors->slide_window();
+    t.Stop();
+    if (logging_enabled)
+      PrintStep("color", t.Seconds(), remaining->size() - survivors->size());
+    swap(remaining, survivors);
+  }
+  return comp;
+}
+
+
+void PrintSCCStats(const Graph &g, const pvector<NodeID> &comp) {
+  unordered_map<NodeID, int64_t> comp_size;
+  for (NodeID u : g.vertices())
+    comp_size[comp[u]]++;
+  int64_t biggest = 0;
+  for (auto &id_size : comp_size)
+    biggest = max(biggest, id_size.second);
+  cout << comp_size.size() << " SCCs (biggest has " << biggest
+       << " vertices)" << endl;
+}
+
+
+// Compares with (iterative) Tarjan, which finds each SCC as its DFS finishes
+// the first vertex of it visited
+bool SCCVerifier(const Graph &g, const pvector<NodeID> &test_comp) {
+  const NodeID kUnvisited = -1;
+  vector<NodeID> index(g.num_nodes(), kUnvisited);
+  vector<NodeID> low(g.num_nodes());
+  vector<NodeID> comp(g.num_nodes(), kNoComp);
+  vector<NodeID> stack;
+  vector<pair<NodeID, int64_t>> call_stack;
+  NodeID next_index = 0;
+  for (NodeID source : g.vertices()) {
+    if (index[source] != kUnvisited)
+      continue;
+    index[source] = low[source] = next_index++;
+    stack.push_back(source);
+    call_stack.push_back(make_pair(source, 0));
+    while (!call_stack.empty()) {
+      NodeID u = call_stack.back().first;
+      int64_t next_edge = call_stack.back().second++;
+      if (next_edge < g.out_degree(u)) {
+        NodeID v = g.out_neigh(u).begin()[next_edge];
+        if (index[v] == kUnvisited) {
+          index[v] = low[v] = next_index++;
+          stack.push_back(v);
+          call_stack.push_back(make_pair(v, 0));
+        } else if (comp[v] == kNoComp) {
+          low[u] = min(low[u], index[v]);
+        }
+        continue;
+      }
+      call_stack.pop_back();
+      if (!call_stack.empty()) {
+        NodeID parent = call_stack.back().first;
+        low[parent] = min(low[parent], low[u]);
+      }
+      if (low[u] == index[u]) {
+        NodeID w;
+        do {
+          w = stack.back();
+          stack.pop_back();
+          comp[w] = u;
+        } while (w != u);
+      }
+    }
+  }
+  unordered_map<NodeID, NodeID> test_to_tarjan;
+  unordered_map<NodeID, NodeID> tarjan_to_test;
+  for (NodeID u : g.vertices()) {
+    auto test_it = test_to_tarjan.insert(make_pair(test_comp[u], comp[u]));
+    auto tarjan_it = tarjan_to_test.insert(make_pair(comp[u], test_comp[u]));
+    if ((test_it.first->second != comp[u]) ||
+        (tarjan_it.first->second != test_comp[u])) {
+      cout << u << ": SCC " << test_comp[u] << " differs from Tarjan's"
+           << endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+
+int main(int argc, char* argv[]) {
+  CLApp cli(argc, argv, "strongly connected components");
+  if (!cli.ParseArgs())
+    return -1;
+  Builder b(cli);
+  Graph g = b.MakeGraph();
+  Graph gt = g.directed() ? Builder::Transpose(g) : Graph();
+  const Graph &backward = g.directed() ? gt : g;
+  auto SCCBound = [&backward] (const Graph &g) {
+    return MultistepSCC(g, backward);
+  };
+  BenchmarkKernel(cli, g, SCCBound, PrintSCCStats, SCCVerifier);
+  return 0;
+}
@@ -0,0 +1,307 @@
+// Copyright (c) 2015, The Regents of the University of California (Regents)
+// See LICENSE.txt for license details
+
+#ifndef SET_INTERSECTION_H_
+#define SET_INTERSECTION_H_
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstddef>
+#include <vector>
+
+#include "benchmark.h"
+
+#if defined __GNUC__ && (defined __x86_64__ || defined __i386__)
+  #define SET_INTERSECTION_X86
+  #include <immintrin.h>
+#endif
+
+
+/*
+GAP Benchmark Suite
+File:   Set Intersection
+
+Counts the elements two sorted neighborhoods have in common, for kernels built
+on neighborhood overlap (e.g. TC)
+ - Ranges are [begin, end) of strictly increasing NodeIDs (as SquishCSR makes)
+ - IntersectionSize picks the widest version the CPU supports at runtime, so
+   a single binary runs everywhere and no -m flags are needed to build it
+ - The SIMD versions compare a block of each range against every element of a
+   block of the other (rotating one block past the other), and advance the
+   block with the smaller last element, or both if they are equal. Once either
+   range has less than a block left, they finish with the next narrower
+   version, down to the scalar merge.
+ - Blocks are 16 (AVX-512), 8 (AVX2), or 4 (SSE4.2) NodeIDs, and the wider
+   versions rely on the CPU also supporting the narrower ones
+ - Kernels that need the common elements themselves (e.g. Truss) visit them
+   with ForEachCommon, which gallops or merges the same way
+ - NeighborMarks intersects one long neighborhood with many much shorter ones
+   by probing a bitmap of it, so kernels share one policy for when to do so
+*/
+
+
+static_assert(sizeof(NodeID) == 4, "SIMD intersection assumes 32-bit NodeID");
+
+
+inline
+size_t IntersectionSizeScalar(const NodeID *a, const NodeID *a_end,
+                              const NodeID *b, const NodeID *b_end) {
+  size_t total = 0;
+  while ((a < a_end) && (b < b_end)) {
+    NodeID x = *a;
+    NodeID y = *b;
+    total += x == y;
+    a += x <= y;
+    b += y <= x;
+  }
+  return total;
+}
+
+
+#if defined SET_INTERSECTION_X86
+
+__attribute__((target("sse4.2,popcnt")))
+inline
+size_t IntersectionSizeSSE(const NodeID *a, const NodeID *a_end,
+                           const NodeID *b, const NodeID *b_end) {
+  size_t total = 0;
+  while ((a_end - a >= 4) && (b_end - b >= 4)) {
+    __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a));
+    __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b));
+    __m128i eq = _mm_cmpeq_epi32(va, vb);
+    vb = _mm_shuffle_epi32(vb, _MM_SHUFFLE(0, 3, 2, 1));
+    eq = _mm_or_si128(eq, _mm_cmpeq_epi32(va, vb));
+    vb = _mm_shuffle_epi32(vb, _MM_SHUFFLE(0, 3, 2, 1));
+    eq = _mm_or_si128(eq, _mm_cmpeq_epi32(va, vb));
+    vb = _mm_shuffle_epi32(vb, _MM_SHUFFLE(0, 3, 2, 1));
+    eq = _mm_or_si128(eq, _mm_cmpeq_epi32(va, vb));
+    total += _mm_popcnt_u32(_mm_movemask_ps(_mm_castsi128_ps(eq)));
+    NodeID a_max = a[3];
+    NodeID b_max = b[3];
+    a += (a_max <= b_max) * 4;
+    b += (b_max <= a_max) * 4;
+  }
+  return total + IntersectionSizeScalar(a, a_end, b, b_end);
+}
+
+
+__attribute__((target("avx2,sse4.2,popcnt")))
+inline
+size_t IntersectionSizeAVX2(const NodeID *a, const NodeID *a_end,
+                            const NodeID *b, const NodeID *b_end) {
+  size_t total = 0;
+  const __m256i rotate = _mm256_setr_epi32(1, 2, 3, 4, 5, 6, 7, 0);
+  while ((a_end - a >= 8) && (b_end - b >= 8)) {
+    __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a));
+    __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b));
+    __m256i eq = _mm256_cmpeq_epi32(va, vb);
+    for (int r=1; r < 8; r++) {
+      vb = _mm256_permutevar8x32_epi32(vb, rotate);
+      eq = _mm256_or_si256(eq, _mm256_cmpeq_epi32(va, vb));
+    }
+    total += _mm_popcnt_u32(_mm256_movemask_ps(_mm256_castsi256_ps(eq)));
+    NodeID a_max = a[7];
+    NodeID b_max = b[7];
+    a += (a_max <= b_max) * 8;
+    b += (b_max <= a_max) * 8;
+  }
+  return total + IntersectionSizeSSE(a, a_end, b, b_end);
+}
+
+
+__attribute__((target("avx512f,avx2,sse4.2,popcnt")))
+inline
+size_t IntersectionSizeAVX512(const NodeID *a, const NodeID *a_end,
+                              const NodeID *b, const NodeID *b_end) {
+  size_t total = 0;
+  while ((a_end - a >= 16) && (b_end - b >= 16)) {
+    __m512i va = _mm512_loadu_si512(a);
+    __m512i vb = _mm512_loadu_si512(b);
+    __mmask16 eq = _mm512_cmpeq_epi32_mask(va, vb);
+    for (int r=1; r < 16; r++) {
+      // maskz form, since gcc warns about the unmasked one under -Wall
+      vb = _mm512_maskz_alignr_epi32(0xFFFF, vb, vb, 1);
+      eq |= _mm512_cmpeq_epi32_mask(va, vb);
+    }
+    total += _mm_popcnt_u32(eq);
+    NodeID a_max = a[15];
+    NodeID b_max = b[15];
+    a += (a_max <= b_max) * 16;
+    b += (b_max <= a_max) * 16;
+  }
+  return total + IntersectionSizeAVX2(a, a_end, b, b_end);
+}
+
+#endif  // SET_INTERSECTION_X86
+
+
+// Finds each element of [a, a_end) in [b, b_end) by galloping (steps that
+// double, then a binary search) from where the last one was found, so it is
+// O(|a| log(|b| / |a|)) rather than O(|a| + |b|) when a is much shorter, and
+// calls visit(a_it, b_it) for each one found
+template <typename VisitFunc>
+void GallopCommon(const NodeID *a, const NodeID *a_end,
+                  const NodeID *b, const NodeID *b_end, VisitFunc visit) {
+  for (; (a < a_end) && (b < b_end); a++) {
+    NodeID x = *a;
+    ptrdiff_t len = b_end - b;
+    ptrdiff_t lo = 0, hi = 0, step = 1;
+    while ((hi < len) && (b[hi] < x)) {
+      lo = hi + 1;
+      hi += step;
+      step *= 2;
+    }
+    b = std::lower_bound(b + lo, b + std::min(hi, len), x);
+    if ((b < b_end) && (*b == x))
+      visit(a, b++);
+  }
+}
+
+
+inline
+size_t IntersectionSizeGalloping(const NodeID *a, const NodeID *a_end,
+                                 const NodeID *b, const NodeID *b_end) {
+  size_t total = 0;
+  GallopCommon(a, a_end, b, b_end,
+               [&total] (const NodeID*, const NodeID*) { total++; });
+  return total;
+}
+
+
+// Calls visit(a_it, b_it) for each element in both [a, a_end) and [b, b_end),
+// galloping the shorter range through the longer one if it is kGallopRatio
+// times shorter, otherwise merging them. The ratio is lower than the one in
+// AdaptiveIntersectionSize since this merge is scalar.
+template <typename VisitFunc>
+void ForEachCommon(const NodeID *a, const NodeID *a_end,
+                   const NodeID *b, const NodeID *b_end, VisitFunc visit) {
+  const ptrdiff_t kGallopRatio = 4;
+  if ((a_end - a) * kGallopRatio < b_end - b) {
+    GallopCommon(a, a_end, b, b_end, visit);
+  } else if ((b_end - b) * kGallopRatio < a_end - a) {
+    GallopCommon(b, b_end, a, a_end,
+                 [&visit] (const NodeID *b_it, const NodeID *a_it) {
+      visit(a_it, b_it);
+    });
+  } else {
+    while ((a < a_end) && (b < b_end)) {
+      NodeID x = *a;
+      NodeID y = *b;
+      if (x == y)
+        visit(a, b);
+      a += x <= y;
+      b += y <= x;
+    }
+  }
+}
+
+
+typedef size_t (*IntersectionFunc)(const NodeID*, const NodeID*,
+                                   const NodeID*, const NodeID*);
+
+
+struct IntersectionKernel {
+  const char *name;
+  IntersectionFunc func;
+};
+
+
+// Widest version this CPU supports
+inline
+IntersectionKernel PickIntersectionKernel() {
+#if defined SET_INTERSECTION_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f"))
+    return {"AVX-512", IntersectionSizeAVX512};
+  if (__builtin_cpu_supports("avx2"))
+    return {"AVX2", IntersectionSizeAVX2};
+  if (__builtin_cpu_supports("sse4.2"))
+    return {"SSE4.2", IntersectionSizeSSE};
+#endif
+  return {"scalar", IntersectionSizeScalar};
+}
+
+
+inline
+const IntersectionKernel& ActiveIntersectionKernel() {
+  static const IntersectionKernel kernel = PickIntersectionKernel();
+  return kernel;
+}
+
+
+// Number of elements in both [a, a_end) and [b, b_end)
+inline
+size_t IntersectionSize(const NodeID *a, const NodeID *a_end,
+                        const NodeID *b, const NodeID *b_end) {
+  return ActiveIntersectionKernel().func(a, a_end, b, b_end);
+}
+
+// Gallops the shorter range through the longer one if it is kGallopRatio
+// times shorter, otherwise merges with IntersectionSize
+inline
+size_t AdaptiveIntersectionSize(const NodeID *a, const NodeID *a_end,
+                                const NodeID *b, const NodeID *b_end) {
+  const ptrdiff_t kGallopRatio = 32;
+  if ((a_end - a) * kGallopRatio < b_end - b)
+    return IntersectionSizeGalloping(a, a_end, b, b_end);
+  if ((b_end - b) * kGallopRatio < a_end - a)
+    return IntersectionSizeGalloping(b, b_end, a, a_end);
+  return IntersectionSize(a, a_end, b, b_end);
+}
+
+
+// Bitmap of one range of NodeIDs (e.g. the neighbors of a high-degree u),
+// set once and then probed with each of many much shorter ranges, which costs
+// only their length. Each thread keeps its own, and the bitmap is allocated
+// by the first Mark, so threads that never meet such a u never pay for it.
+class NeighborMarks {
+ public:
+  static const int64_t kMarkDegree = 256;
+  static const ptrdiff_t kMarkRatio = 8;
+
+  explicit NeighborMarks(int64_t num_nodes) : num_nodes_(num_nodes) {}
+
+  // Whether to probe a range of probe_len against marks of a range of
+  // marked_len from a vertex of the given degree, rather than intersect them
+  static bool Worthwhile(int64_t degree, ptrdiff_t marked_len,
+                         ptrdiff_t probe_len) {
+    return (degree >= kMarkDegree) && (probe_len * kMarkRatio < marked_len);
+  }
+
+  // Marks [a, a_end), unless a range is already marked
+  void Mark(const NodeID *a, const NodeID *a_end) {
+    if (first_ != nullptr)
+      return;
+    if (marked_.empty())
+      marked_.resize(num_nodes_);
+    for (const NodeID *it = a; it < a_end; it++)
+      marked_[*it] = true;
+    first_ = a;
+    last_ = a_end;
+  }
+
+  // Number of elements of [b, b_end) in the marked range
+  size_t Count(const NodeID *b, const NodeID *b_end) const {
+    size_t total = 0;
+    for (; b < b_end; b++)
+      total += marked_[*b];
+    return total;
+  }
+
+  // Unmarks the marked range (if any), touching only its elements
+  void Clear() {
+    if (first_ == nullptr)
+      return;
+    for (const NodeID *it = first_; it < last_; it++)
+      marked_[*it] = false;
+    first_ = nullptr;
+  }
+
+ private:
+  int64_t num_nodes_;
+  std::vector<bool> marked_;
+  const NodeID *first_ = nullptr;
+  const NodeID *last_ = nullptr;
+};
+
+#endif  // SET_INTERSECTION_H_
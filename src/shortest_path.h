@@ -0,0 +1,402 @@
+// Copyright (c) 2015, The Regents of the University of California (Regents)
+// See LICENSE.txt for license details
+
+#ifndef SHORTEST_PATH_H_
+#define SHORTEST_PATH_H_
+
+#include <algorithm>
+#include <cinttypes>
+#include <iostream>
+#include <limits>
+#include <queue>
+#include <random>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "benchmark.h"
+#include "bin_pool.h"
+#include "bitmap.h"
+#include "edge_balancer.h"
+#include "graph.h"
+#include "multi_queue.h"
+#include "platform_atomics.h"
+#include "pvector.h"
+#include "timer.h"
+
+
+/*
+GAP Benchmark Suite
+File:   Shortest Path
+
+Parallel single-source shortest-path searches over a WGraph
+ - DeltaStep (delta-stepping) and MultiQueueSSSP, with EstimateDelta and
+   ProbeDelta to pick delta, are described with the sssp kernel (sssp.cc)
+ - Shared so other kernels (e.g. alt building its landmark tables) can run
+   full searches with the same code sssp is benchmarked with
+ - PrintSSSPStats and SSSPVerifier (checks against a serial Dijkstra) are
+   shared too
+ - DeltaStep expects neighborhoods sorted by weight (Builder::SortByWeight)
+*/
+
+
+const WeightT kDistInf = std::numeric_limits<WeightT>::max()/2;
+const size_t kMaxBin = std::numeric_limits<size_t>::max()/2;
+const size_t kBinSizeThreshold = 1000;
+
+// Atomically lowers dist[v] to new_dist, returns false if it was already lower
+inline
+bool LowerDist(pvector<WeightT> &dist, NodeID v, WeightT new_dist) {
+  WeightT old_dist = dist[v];
+  while (new_dist < old_dist) {
+    if (compare_and_swap(dist[v], old_dist, new_dist))
+      return true;
+    old_dist = dist[v];
+  }
+  return false;
+}
+
+// If wn.v was already waiting in a later bin than curr_bin and stays in it, it
+// isn't added again, since that earlier entry will see the lowered distance
+inline
+void RelaxEdge(NodeID u, WNode wn, WeightT delta, size_t curr_bin,
+               pvector<WeightT> &dist, LocalBins<NodeID> &local_bins) {
+  WeightT old_dist = dist[wn.v];
+  WeightT new_dist = dist[u] + wn.w;
+  size_t dest_bin = new_dist/delta;
+  if (LowerDist(dist, wn.v, new_dist)) {
+    if ((dest_bin == curr_bin) || (old_dist == kDistInf) ||
+        (static_cast<size_t>(old_dist/delta) != dest_bin))
+      local_bins.push_back(dest_bin, wn.v);
+  }
+}
+
+// Number of light edges (weight < delta) at the front of each neighborhood,
+// relies on neighborhoods being sorted by weight (Builder::SortByWeight), so
+// it only needs computing once per graph and delta, outside any timed search
+pvector<NodeID> CountLightEdges(const WGraph &g, WeightT delta) {
+  pvector<NodeID> light_degree(g.num_nodes());
+  auto LighterThanDelta = [](const WNode &wn, WeightT delta) {
+    return wn.w < delta;
+  };
+  #pragma omp parallel for schedule(dynamic, 1024)
+  for (NodeID u=0; u < g.num_nodes(); u++) {
+    auto neigh = g.out_neigh(u);
+    light_degree[u] = std::lower_bound(neigh.begin(), neigh.end(), delta,
+                                       LighterThanDelta) - neigh.begin();
+  }
+  return light_degree;
+}
+
+
+// Stops early (leaving larger distances unsettled) once no bins below
+// dist_limit remain, which is how probes (ProbeDelta) bound their work, and
+// light_degree must come from CountLightEdges(g, delta)
+pvector<WeightT> DeltaStep(const WGraph &g, NodeID source, WeightT delta,
+                           const pvector<NodeID> &light_degree,
+                           BinPool<NodeID> &bin_pool,
+                           bool logging_enabled = true,
+                           WeightT dist_limit = kDistInf) {
+  const size_t bin_limit = dist_limit == kDistInf ? kMaxBin :
+      static_cast<size_t>((dist_limit + delta - 1) / delta);
+  Timer t;
+  pvector<WeightT> dist(g.num_nodes(), kDistInf);
+  dist[source] = 0;
+  // Duplicates are dropped when filling frontier (in_frontier), so it never
+  // holds more than num_nodes, and its pages are only touched when first used
+  pvector<NodeID> frontier(g.num_nodes());
+  Bitmap in_frontier(g.num_nodes());
+  in_frontier.reset();
+  Bitmap settled(g.num_nodes());
+  settled.reset();
+  pvector<NodeID> settled_frontier(g.num_nodes());
+  size_t settled_tail = 0;
+  // two element arrays for double buffering curr=iter&1, next=(iter+1)&1
+  size_t shared_indexes[2] = {0, kMaxBin};
+  size_t frontier_tails[2] = {1, 0};
+  frontier[0] = source;
+  in_frontier.set_bit(source);
+  EdgeBalancer<WGraph> balancer(g);
+  typedef EdgeBalancer<WGraph>::EdgeRange EdgeRange;
+  auto LightEdges = [&light_degree](NodeID u) {
+    return EdgeRange(0, light_degree[u]);
+  };
+  auto HeavyEdges = [&g, &light_degree](NodeID u) {
+    return EdgeRange(light_degree[u], g.out_degree(u));
+  };
+  t.Start();
+  #pragma omp parallel
+  {
+    LocalBins<NodeID> &local_bins = bin_pool.local();
+    local_bins.clear();
+    std::vector<NodeID> fused_bin;
+    std::vector<NodeID> settled_local;
+    size_t iter = 0;
+    while (shared_indexes[iter&1] < bin_limit) {
+      size_t &curr_bin_index = shared_indexes[iter&1];
+      size_t &next_bin_index = shared_indexes[(iter+1)&1];
+      size_t &curr_frontier_tail = frontier_tails[iter&1];
+      size_t &next_frontier_tail = frontier_tails[(iter+1)&1];
+      const size_t curr_bin = curr_bin_index;
+      const WeightT curr_bin_start = delta * static_cast<WeightT>(curr_bin);
+      // Queues u (once) for heavy edge relaxation when current bin is done
+      auto MarkSettled = [&](NodeID u) {
+        if ((light_degree[u] < g.out_degree(u)) && !settled.get_bit(u) &&
+            settled.set_bit_atomic(u))
+          settled_local.push_back(u);
+      };
+      auto RelaxFromCurrBin = [&](NodeID u, WNode wn) {
+        if (dist[u] >= curr_bin_start)
+          RelaxEdge(u, wn, delta, curr_bin, dist, local_bins);
+      };
+      balancer.ForEachEdge(frontier.begin(),
+                           frontier.begin() + curr_frontier_tail,
+                           RelaxFromCurrBin, LightEdges);
+      #pragma omp for nowait schedule(dynamic, 1024)
+      for (size_t i=0; i < curr_frontier_tail; i++) {
+        NodeID u = frontier[i];
+        in_frontier.clear_bit_atomic(u);
+        if (dist[u] >= curr_bin_start)
+          MarkSettled(u);
+      }
+      // Bucket fusion: keep going on own small share of current bin locally
+      while (!local_bins.empty(curr_bin) &&
+             (local_bins.size(curr_bin) < kBinSizeThreshold)) {
+        local_bins.drain(curr_bin, fused_bin);
+        for (NodeID u : fused_bin) {
+          auto light_end = g.out_neigh(u).begin() + light_degree[u];
+          for (auto it = g.out_neigh(u).begin(); it < light_end; it++)
+            RelaxEdge(u, *it, delta, curr_bin, dist, local_bins);
+          MarkSettled(u);
+        }
+      }
+      size_t local_next = local_bins.first_nonempty(curr_bin);
+      if (local_next < local_bins.num_bins()) {
+        #pragma omp critical
+        next_bin_index = std::min(next_bin_index, local_next);
+      }
+      if (!settled_local.empty()) {
+        size_t copy_start = fetch_and_add(settled_tail, settled_local.size());
+        std::copy(settled_local.begin(), settled_local.end(),
+             settled_frontier.begin() + copy_start);
+        settled_local.clear();
+      }
+      #pragma omp barrier
+      // Once current bin stays empty its distances are final, so heavy edges
+      // of the vertices settled in it are relaxed (only once) and votes redone
+      if (next_bin_index != curr_bin) {
+        balancer.ForEachEdge(settled_frontier.begin(),
+                             settled_frontier.begin() + settled_tail,
+                             RelaxFromCurrBin, HeavyEdges);
+        local_next = local_bins.first_nonempty(curr_bin);
+        if (local_next < local_bins.num_bins()) {
+          #pragma omp critical
+          next_bin_index = std::min(next_bin_index, local_next);
+        }
+        #pragma omp barrier
+        #pragma omp single nowait
+        settled_tail = 0;
+      }
+      #pragma omp single nowait
+      {
+        t.Stop();
+        if (logging_enabled)
+          PrintStep(curr_bin, t.Millisecs(), curr_frontier_tail);
+        t.Start();
+        curr_bin_index = kMaxBin;
+        curr_frontier_tail = 0;
+      }
+      if (!local_bins.empty(next_bin_index)) {
+        local_bins.drain(next_bin_index, fused_bin);
+        auto unique_end = std::remove_if(fused_bin.begin(), fused_bin.end(),
+                                         [&in_frontier](NodeID v) {
+          return !in_frontier.set_bit_atomic(v);
+        });
+        size_t copy_start = fetch_and_add(next_frontier_tail,
+                                          unique_end - fused_bin.begin());
+        std::copy(fused_bin.begin(), unique_end, frontier.begin() + copy_start);
+      }
+      iter++;
+      #pragma omp barrier
+    }
+    #pragma omp single
+    if (logging_enabled)
+      std::cout << "took " << iter << " iterations" << std::endl;
+  }
+  return dist;
+}
+
+
+// Threads (in a parallel region of their own) repeatedly take a (nearly)
+// closest vertex u from mq and call relax(u, u_dist), which returns how many
+// vertices it pushed, until num_pending (queued vertices plus those being
+// processed, so 0 only once all are done) reaches 0. Returns the number of
+// pops, including stale entries, which are skipped since a newer one was
+// pushed when dist[u] was lowered.
+template <typename RelaxFunc>
+int64_t DrainMultiQueue(MultiQueue<WeightT, NodeID> &mq, int64_t &num_pending,
+                        const pvector<WeightT> &dist, RelaxFunc relax) {
+  int64_t num_pops = 0;
+  #pragma omp parallel reduction(+ : num_pops)
+  {
+    WeightT u_dist;
+    NodeID u;
+    // num_pending is updated atomically, so read with load_acquire
+    while (load_acquire(num_pending) != 0) {
+      if (!mq.pop(u_dist, u)) {
+        // nothing to take right now, so let threads with work run
+        std::this_thread::yield();
+        continue;
+      }
+      num_pops++;
+      int64_t num_pushed = u_dist == dist[u] ? relax(u, u_dist) : 0;
+      fetch_and_add(num_pending, num_pushed - 1);
+    }
+  }
+  return num_pops;
+}
+
+
+// Label-correcting alternative to DeltaStep with no parameter to tune, threads
+// repeatedly take a (nearly) closest vertex from a shared MultiQueue
+pvector<WeightT> MultiQueueSSSP(const WGraph &g, NodeID source,
+                                bool logging_enabled = true) {
+  pvector<WeightT> dist(g.num_nodes(), kDistInf);
+  dist[source] = 0;
+  MultiQueue<WeightT, NodeID> mq;
+  mq.push(0, source);
+  int64_t num_pending = 1;
+  auto Relax = [&](NodeID u, WeightT u_dist) {
+    int64_t num_pushed = 0;
+    for (WNode wn : g.out_neigh(u)) {
+      if (LowerDist(dist, wn.v, u_dist + wn.w)) {
+        mq.push(u_dist + wn.w, wn.v);
+        num_pushed++;
+      }
+    }
+    return num_pushed;
+  };
+  int64_t num_pops = DrainMultiQueue(mq, num_pending, dist, Relax);
+  if (logging_enabled)
+    std::cout << "took " << num_pops << " pops" << std::endl;
+  return dist;
+}
+
+
+// Picks delta from sampled graph statistics: the mean edge weight divided by
+// the mean out-degree. Following the analysis for random weights in [1], a bin
+// of that width should give each settled vertex about one light edge to relax.
+WeightT EstimateDelta(const WGraph &g) {
+  const int64_t kNumSamples = 1000;
+  double avg_degree = static_cast<double>(g.num_edges_directed()) /
+                      g.num_nodes();
+  if (g.num_edges_directed() == 0)
+    return 1;
+  std::mt19937 rng(kRandSeed);
+  std::uniform_int_distribution<int64_t> edge_dist(0,
+                                                   g.num_edges_directed()-1);
+  const WNode* g_out_start = g.out_neigh(0).begin();
+  double weight_total = 0;
+  for (int64_t i=0; i < kNumSamples; i++)
+    weight_total += g_out_start[edge_dist(rng)].w;
+  double avg_weight = weight_total / kNumSamples;
+  PrintStep("Sampled Avg Weight", static_cast<int64_t>(avg_weight));
+  WeightT delta = static_cast<WeightT>(avg_weight /
+                                       std::max(avg_degree, 1.0));
+  if (std::is_integral<WeightT>::value && (delta < 1))
+    delta = 1;
+  return delta;
+}
+
+
+// Refines estimate by timing short runs with deltas from estimate/4 to
+// estimate*64. To give every candidate the same work, each run only settles
+// vertices up to a distance horizon that holds roughly kHorizonFraction of the
+// vertices reached from a sample source.
+WeightT ProbeDelta(const WGraph &g, WeightT estimate,
+                   BinPool<NodeID> &bin_pool) {
+  const int64_t kNumSamples = 1000;
+  const double kHorizonFraction = 0.5;
+  SourcePicker<WGraph> sp(g);
+  NodeID source = sp.PickNext();
+  pvector<WeightT> dist = DeltaStep(g, source, estimate,
+                                    CountLightEdges(g, estimate), bin_pool,
+                                    false);
+  std::mt19937 rng(kRandSeed);
+  std::uniform_int_distribution<NodeID> udist(0, g.num_nodes()-1);
+  std::vector<WeightT> reached;
+  for (int64_t i=0; i < kNumSamples; i++) {
+    WeightT d = dist[udist(rng)];
+    if (d != kDistInf)
+      reached.push_back(d);
+  }
+  if (reached.empty())
+    return estimate;
+  std::sort(reached.begin(), reached.end());
+  WeightT horizon = reached[static_cast<size_t>(reached.size() *
+                                                kHorizonFraction)];
+  WeightT best_delta = estimate;
+  double best_seconds = std::numeric_limits<double>::max();
+  Timer t;
+  for (int shift=-2; shift <= 6; shift++) {
+    WeightT candidate = shift < 0 ? estimate / (1 << -shift) :
+                                    estimate * (1 << shift);
+    if ((candidate <= 0) || (candidate > horizon))
+      continue;
+    pvector<NodeID> light_degree = CountLightEdges(g, candidate);
+    t.Start();
+    DeltaStep(g, source, candidate, light_degree, bin_pool, false, horizon);
+    t.Stop();
+    PrintStep("p", t.Seconds(), static_cast<int64_t>(candidate));
+    if (t.Seconds() < best_seconds) {
+      best_seconds = t.Seconds();
+      best_delta = candidate;
+    }
+  }
+  return best_delta;
+}
+
+
+void PrintSSSPStats(const WGraph &g, const pvector<WeightT> &dist) {
+  auto NotInf = [](WeightT d) { return d != kDistInf; };
+  int64_t num_reached = std::count_if(dist.begin(), dist.end(), NotInf);
+  std::cout << "SSSP Tree reaches " << num_reached << " nodes" << std::endl;
+}
+
+
+// Compares against simple serial implementation
+bool SSSPVerifier(const WGraph &g, NodeID source,
+                  const pvector<WeightT> &dist_to_test) {
+  // Serial Dijkstra implementation to get oracle distances
+  pvector<WeightT> oracle_dist(g.num_nodes(), kDistInf);
+  oracle_dist[source] = 0;
+  typedef std::pair<WeightT, NodeID> WN;
+  std::priority_queue<WN, std::vector<WN>, std::greater<WN>> mq;
+  mq.push(std::make_pair(0, source));
+  while (!mq.empty()) {
+    WeightT td = mq.top().first;
+    NodeID u = mq.top().second;
+    mq.pop();
+    if (td == oracle_dist[u]) {
+      for (WNode wn : g.out_neigh(u)) {
+        if (td + wn.w < oracle_dist[wn.v]) {
+          oracle_dist[wn.v] = td + wn.w;
+          mq.push(std::make_pair(td + wn.w, wn.v));
+        }
+      }
+    }
+  }
+  // Report any mismatches
+  bool all_ok = true;
+  for (NodeID n : g.vertices()) {
+    if (dist_to_test[n] != oracle_dist[n]) {
+      std::cout << n << ": " << dist_to_test[n] << " != " << oracle_dist[n]
+                << std::endl;
+      all_ok = false;
+    }
+  }
+  return all_ok;
+}
+
+#endif  // SHORTEST_PATH_H_
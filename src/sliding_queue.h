@@ -5,8 +5,12 @@
 #define SLIDING_QUEUE_H_
 
 #include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <vector>
 
 #include "platform_atomics.h"
+#include "util.h"
 
 
 /*
@@ -17,6 +21,11 @@ Author: Scott Beamer
 Double-buffered queue so appends aren't seen until SlideWindow() called
  - Use QueueBuffer when used in parallel to avoid false sharing by doing
    bulk appends from thread-local storage
+ - Storage is split into fixed-size chunks that are allocated (lock-free) the
+   first time they are written, so only the size passed to the constructor is
+   an upper bound and memory tracks the most elements ever held
+ - Chunks and the per-thread QueueBuffer storage are kept through reset() and
+   reused by later steps and searches, so steady state does no allocation
 */
 
 
@@ -25,24 +34,76 @@ class QueueBuffer;
 
 template <typename T>
 class SlidingQueue {
-  T *shared;
+  static const size_t kLogChunkSize = 16;
+  static const size_t kChunkSize = static_cast<size_t>(1) << kLogChunkSize;
+
+  T **chunks;
+  size_t num_chunks;
   size_t shared_in;
   size_t shared_out_start;
   size_t shared_out_end;
+  std::vector<T*> local_buffers;
+  std::vector<size_t> local_sizes;
   friend class QueueBuffer<T>;
 
+  // Safe to call concurrently, loser of race frees its allocation
+  void EnsureChunk(size_t chunk) {
+    if (chunks[chunk] == nullptr) {
+      T *fresh = new T[kChunkSize];
+      if (!compare_and_swap(chunks[chunk], static_cast<T*>(nullptr), fresh))
+        delete[] fresh;
+    }
+  }
+
+  void CopyIn(const T *from, size_t count, size_t dest) {
+    while (count != 0) {
+      size_t chunk = dest >> kLogChunkSize;
+      size_t chunk_offset = dest & (kChunkSize - 1);
+      size_t to_copy = std::min(count, kChunkSize - chunk_offset);
+      EnsureChunk(chunk);
+      std::copy(from, from + to_copy, chunks[chunk] + chunk_offset);
+      from += to_copy;
+      dest += to_copy;
+      count -= to_copy;
+    }
+  }
+
+  // Storage for calling thread's QueueBuffer, nullptr if it can't be kept
+  T* LocalStorage(size_t local_size) {
+    size_t tid = ThreadNum();
+    if (tid >= local_buffers.size())
+      return nullptr;
+    if (local_sizes[tid] < local_size) {
+      delete[] local_buffers[tid];
+      local_buffers[tid] = new T[local_size];
+      local_sizes[tid] = local_size;
+    }
+    return local_buffers[tid];
+  }
+
  public:
-  explicit SlidingQueue(size_t shared_size) {
-    shared = new T[shared_size];
+  explicit SlidingQueue(size_t shared_size)
+      : local_buffers(MaxThreads(), nullptr), local_sizes(MaxThreads(), 0) {
+    num_chunks = (shared_size + kChunkSize - 1) / kChunkSize;
+    chunks = new T*[num_chunks];
+    std::fill(chunks, chunks + num_chunks, nullptr);
     reset();
   }
 
+  SlidingQueue(const SlidingQueue &other) = delete;
+
   ~SlidingQueue() {
-    delete[] shared;
+    for (size_t c=0; c < num_chunks; c++)
+      delete[] chunks[c];
+    delete[] chunks;
+    for (T *buffer : local_buffers)
+      delete[] buffer;
   }
 
   void push_back(T to_add) {
-    shared[shared_in++] = to_add;
+    EnsureChunk(shared_in >> kLogChunkSize);
+    chunks[shared_in >> kLogChunkSize][shared_in & (kChunkSize - 1)] = to_add;
+    shared_in++;
   }
 
   bool empty() const {
@@ -60,14 +121,57 @@ class SlidingQueue {
     shared_out_end = shared_in;
   }
 
-  typedef T* iterator;
+  // Random-access iterator over positions in the chunked storage
+  class iterator {
+    T **chunks_;
+    size_t pos_;
+
+   public:
+    typedef std::random_access_iterator_tag iterator_category;
+    typedef T value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef T* pointer;
+    typedef T& reference;
+
+    iterator() : chunks_(nullptr), pos_(0) {}
+    iterator(T **chunks, size_t pos) : chunks_(chunks), pos_(pos) {}
+
+    T& operator*() const {
+      return chunks_[pos_ >> kLogChunkSize][pos_ & (kChunkSize - 1)];
+    }
+    T& operator[](difference_type n) const { return *(*this + n); }
+
+    iterator& operator++() { pos_++; return *this; }
+    iterator operator++(int) { iterator old = *this; pos_++; return old; }
+    iterator& operator--() { pos_--; return *this; }
+    iterator operator--(int) { iterator old = *this; pos_--; return old; }
+    iterator& operator+=(difference_type n) { pos_ += n; return *this; }
+    iterator& operator-=(difference_type n) { pos_ -= n; return *this; }
+    iterator operator+(difference_type n) const {
+      return iterator(chunks_, pos_ + n);
+    }
+    iterator operator-(difference_type n) const {
+      return iterator(chunks_, pos_ - n);
+    }
+    difference_type operator-(const iterator &other) const {
+      return static_cast<difference_type>(pos_) -
+             static_cast<difference_type>(other.pos_);
+    }
+
+    bool operator==(const iterator &other) const { return pos_ == other.pos_; }
+    bool operator!=(const iterator &other) const { return pos_ != other.pos_; }
+    bool operator<(const iterator &other) const { return pos_ < other.pos_; }
+    bool operator>(const iterator &other) const { return pos_ > other.pos_; }
+    bool operator<=(const iterator &other) const { return pos_ <= other.pos_; }
+    bool operator>=(const iterator &other) const { return pos_ >= other.pos_; }
+  };
 
   iterator begin() const {
-    return shared + shared_out_start;
+    return iterator(chunks, shared_out_start);
   }
 
   iterator end() const {
-    return shared + shared_out_end;
+    return iterator(chunks, shared_out_end);
   }
 
   size_t size() const {
@@ -76,22 +180,29 @@ class SlidingQueue {
 };
 
 
+// At most one QueueBuffer per thread should be alive for a given SlidingQueue,
+// since the storage it borrows from that queue is indexed by thread number
 template <typename T>
 class QueueBuffer {
   size_t in;
   T *local_queue;
   SlidingQueue<T> &sq;
   const size_t local_size;
+  bool owns_storage;
 
  public:
   explicit QueueBuffer(SlidingQueue<T> &master, size_t given_size = 16384)
       : sq(master), local_size(given_size) {
     in = 0;
-    local_queue = new T[local_size];
+    local_queue = sq.LocalStorage(local_size);
+    owns_storage = local_queue == nullptr;
+    if (owns_storage)
+      local_queue = new T[local_size];
   }
 
   ~QueueBuffer() {
-    delete[] local_queue;
+    if (owns_storage)
+      delete[] local_queue;
   }
 
   void push_back(T to_add) {
@@ -101,9 +212,8 @@ class QueueBuffer {
   }
 
   void flush() {
-    T *shared_queue = sq.shared;
     size_t copy_start = fetch_and_add(sq.shared_in, in);
-    std::copy(local_queue, local_queue+in, shared_queue+copy_start);
+    sq.CopyIn(local_queue, in, copy_start);
     in = 0;
   }
 };
@@ -1,19 +1,17 @@
 // Copyright (c) 2015, The Regents of the University of California (Regents)
 // See LICENSE.txt for license details
 
+#include <algorithm>
 #include <cinttypes>
-#include <limits>
 #include <iostream>
-#include <queue>
 #include <vector>
 
 #include "benchmark.h"
 #include "builder.h"
 #include "command_line.h"
 #include "graph.h"
-#include "platform_atomics.h"
 #include "pvector.h"
-#include "timer.h"
+#include "shortest_path.h"
 
 
 /*
@@ -25,16 +23,42 @@ Returns array of distances for all vertices from given source vertex
 
 This SSSP implementation makes use of the ∆-stepping algorithm [1]. The type
 used for weights and distances (WeightT) is typedefined in benchmark.h. The
-delta parameter (-d) should be set for each input graph.
+delta parameter (-d) should be set for each input graph. Alternatively, with
+-d auto it is estimated from sampled edge weights and the average degree
+(EstimateDelta), and with -d probe that estimate is further refined by timing
+short bounded runs with nearby values (ProbeDelta).
 
-The bins of width delta are actually all thread-local and of type std::vector
-so they can grow but are otherwise capacity-proportional. Each iteration is
+For graphs where no single delta works well, -m selects MultiQueueSSSP instead,
+which needs no tuning. It is a label-correcting search where each thread keeps
+taking a vertex with a small (but not necessarily the smallest) distance from a
+relaxed concurrent priority queue (MultiQueue), and relaxes all of its edges.
+
+Both searches are implemented in shortest_path.h so other kernels can use them.
+
+The bins of width delta are actually all thread-local LocalBins, which grow by
+taking blocks from a per-thread pool and return them when emptied, so storage
+is reused across bins and (via the BinPool) across trials. Each iteration is
 done in two phases separated by barriers. In the first phase, the current
 shared bin is processed by all threads. As they find vertices whose distance
 they are able to improve, they add them to their thread-local bins. During this
 phase, each thread also votes on what the next bin should be (smallest
 non-empty bin). In the next phase, each thread copies their selected
-thread-local bin into the shared bin.
+thread-local bin into the shared bin. The shared bin is processed with an
+EdgeBalancer, so its edges rather than its vertices are divided among threads.
+
+To reduce the number of barrier-bound iterations, we use bucket fusion [2].
+Before voting, a thread keeps processing its own portion of the current bin
+locally for as long as it is small (under kBinSizeThreshold). This takes care
+of the long tails of tiny iterations common on high-diameter graphs without
+any global synchronization.
+
+As in the original formulation [1], edges are split into light (weight < delta)
+and heavy ones. Since a heavy edge can never land in the current bin, it only
+needs to be relaxed once, after the current bin stays empty and the distances
+of the vertices settled in it are final. The builder sorts each neighborhood by
+weight (SortByWeight), so the light edges of a vertex are simply a prefix of
+its neighborhood, and both kinds are processed by the EdgeBalancer using the
+light degrees computed once before the trials (CountLightEdges).
 
 Once a vertex is added to a bin, it is not removed, even if its distance is
 later updated and it now appears in a lower bin. We find ignoring vertices if
@@ -42,135 +66,23 @@ their current distance is less than the min distance for the bin to remove
 enough redundant work that this is faster than removing the vertex from older
 bins.
 
+To keep the shared frontier within one slot per vertex, a vertex is only added
+to a later bin if it was not already waiting in that bin, and when a bin is
+copied into the frontier, duplicates from different threads are dropped with
+an atomically updated bitmap (in_frontier).
+
 [1] Ulrich Meyer and Peter Sanders. "δ-stepping: a parallelizable shortest path
     algorithm." Journal of Algorithms, 49(1):114–152, 2003.
+
+[2] Zhang, Yunming, Ajay Brahmakshatriya, Xinyi Chen, Laxman Dhulipala,
+    Shoaib Kamil, Saman Amarasinghe, and Julian Shun. "Optimizing ordered graph
+    algorithms with GraphIt." The 18th International Symposium on Code
+    Generation and Optimization (CGO), pages 158-170, 2020.
 */
 
 
 using namespace std;
 
-const WeightT kDistInf = numeric_limits<WeightT>::max()/2;
-const size_t kMaxBin = numeric_limits<size_t>::max()/2;
-
-pvector<WeightT> DeltaStep(const WGraph &g, NodeID source, WeightT delta) {
-  Timer t;
-  pvector<WeightT> dist(g.num_nodes(), kDistInf);
-  dist[source] = 0;
-  pvector<NodeID> frontier(g.num_edges_directed());
-  // two element arrays for double buffering curr=iter&1, next=(iter+1)&1
-  size_t shared_indexes[2] = {0, kMaxBin};
-  size_t frontier_tails[2] = {1, 0};
-  frontier[0] = source;
-  t.Start();
-  #pragma omp parallel
-  {
-    vector<vector<NodeID> > local_bins(0);
-    size_t iter = 0;
-    while (shared_indexes[iter&1] != kMaxBin) {
-      size_t &curr_bin_index = shared_indexes[iter&1];
-      size_t &next_bin_index = shared_indexes[(iter+1)&1];
-      size_t &curr_frontier_tail = frontier_tails[iter&1];
-      size_t &next_frontier_tail = frontier_tails[(iter+1)&1];
-      #pragma omp for nowait schedule(dynamic, 64)
-      for (size_t i=0; i < curr_frontier_tail; i++) {
-        NodeID u = frontier[i];
-        if (dist[u] >= delta * static_cast<WeightT>(curr_bin_index)) {
-          for (WNode wn : g.out_neigh(u)) {
-            WeightT old_dist = dist[wn.v];
-            WeightT new_dist = dist[u] + wn.w;
-            if (new_dist < old_dist) {
-              bool changed_dist = true;
-              while (!compare_and_swap(dist[wn.v], old_dist, new_dist)) {
-                old_dist = dist[wn.v];
-                if (old_dist <= new_dist) {
-                  changed_dist = false;
-                  break;
-                }
-              }
-              if (changed_dist) {
-                size_t dest_bin = new_dist/delta;
-                if (dest_bin >= local_bins.size()) {
-                  local_bins.resize(dest_bin+1);
-                }
-                local_bins[dest_bin].push_back(wn.v);
-              }
-            }
-          }
-        }
-      }
-      for (size_t i=curr_bin_index; i < local_bins.size(); i++) {
-        if (!local_bins[i].empty()) {
-          #pragma omp critical
-          next_bin_index = min(next_bin_index, i);
-          break;
-        }
-      }
-      #pragma omp barrier
-      #pragma omp single nowait
-      {
-        t.Stop();
-        PrintStep(curr_bin_index, t.Millisecs(), curr_frontier_tail);
-        t.Start();
-        curr_bin_index = kMaxBin;
-        curr_frontier_tail = 0;
-      }
-      if (next_bin_index < local_bins.size()) {
-        size_t copy_start = fetch_and_add(next_frontier_tail,
-                                          local_bins[next_bin_index].size());
-        copy(local_bins[next_bin_index].begin(),
-             local_bins[next_bin_index].end(), frontier.data() + copy_start);
-        local_bins[next_bin_index].resize(0);
-      }
-      iter++;
-      #pragma omp barrier
-    }
-    #pragma omp single
-    cout << "took " << iter << " iterations" << endl;
-  }
-  return dist;
-}
-
-
-void PrintSSSPStats(const WGraph &g, const pvector<WeightT> &dist) {
-  auto NotInf = [](WeightT d) { return d != kDistInf; };
-  int64_t num_reached = count_if(dist.begin(), dist.end(), NotInf);
-  cout << "SSSP Tree reaches " << num_reached << " nodes" << endl;
-}
-
-
-// Compares against simple serial implementation
-bool SSSPVerifier(const WGraph &g, NodeID source,
-                  const pvector<WeightT> &dist_to_test) {
-  // Serial Dijkstra implementation to get oracle distances
-  pvector<WeightT> oracle_dist(g.num_nodes(), kDistInf);
-  oracle_dist[source] = 0;
-  typedef pair<WeightT, NodeID> WN;
-  priority_queue<WN, vector<WN>, greater<WN>> mq;
-  mq.push(make_pair(0, source));
-  while (!mq.empty()) {
-    WeightT td = mq.top().first;
-    NodeID u = mq.top().second;
-    mq.pop();
-    if (td == oracle_dist[u]) {
-      for (WNode wn : g.out_neigh(u)) {
-        if (td + wn.w < oracle_dist[wn.v]) {
-          oracle_dist[wn.v] = td + wn.w;
-          mq.push(make_pair(td + wn.w, wn.v));
-        }
-      }
-    }
-  }
-  // Report any mismatches
-  bool all_ok = true;
-  for (NodeID n : g.vertices()) {
-    if (dist_to_test[n] != oracle_dist[n]) {
-      cout << n << ": " << dist_to_test[n] << " != " << oracle_dist[n] << endl;
-      all_ok = false;
-    }
-  }
-  return all_ok;
-}
-
 
 int main(int argc, char* argv[]) {
   CLDelta<WeightT> cli(argc, argv, "single-source shortest-path");
@@ -178,14 +90,32 @@ int main(int argc, char* argv[]) {
     return -1;
   WeightedBuilder b(cli);
   WGraph g = b.MakeGraph();
-  SourcePicker<WGraph> sp(g, cli.start_vertex());
-  auto SSSPBound = [&sp, &cli] (const WGraph &g) {
-    return DeltaStep(g, sp.PickNext(), cli.delta());
-  };
   SourcePicker<WGraph> vsp(g, cli.start_vertex());
   auto VerifierBound = [&vsp] (const WGraph &g, const pvector<WeightT> &dist) {
     return SSSPVerifier(g, vsp.PickNext(), dist);
   };
+  if (cli.use_multiqueue()) {
+    SourcePicker<WGraph> sp(g, cli.start_vertex());
+    auto MQBound = [&sp] (const WGraph &g) {
+      return MultiQueueSSSP(g, sp.PickNext());
+    };
+    BenchmarkKernel(cli, g, MQBound, PrintSSSPStats, VerifierBound);
+    return 0;
+  }
+  WeightedBuilder::SortByWeight(g);
+  BinPool<NodeID> bin_pool;
+  WeightT delta = cli.delta();
+  if (cli.auto_delta()) {
+    delta = EstimateDelta(g);
+    if (cli.probe_delta())
+      delta = ProbeDelta(g, delta, bin_pool);
+    PrintStep("Delta", static_cast<int64_t>(delta));
+  }
+  pvector<NodeID> light_degree = CountLightEdges(g, delta);
+  SourcePicker<WGraph> sp(g, cli.start_vertex());
+  auto SSSPBound = [&sp, delta, &light_degree, &bin_pool] (const WGraph &g) {
+    return DeltaStep(g, sp.PickNext(), delta, light_degree, bin_pool);
+  };
   BenchmarkKernel(cli, g, SSSPBound, PrintSSSPStats, VerifierBound);
   return 0;
 }
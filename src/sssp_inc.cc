@@ -0,0 +1,78 @@
+// Copyright (c) 2015, The Regents of the University of California (Regents)
+// See LICENSE.txt for license details
+
+#include <iostream>
+
+#include "benchmark.h"
+#include "bin_pool.h"
+#include "builder.h"
+#include "command_line.h"
+#include "dynamic_graph.h"
+#include "edge_update.h"
+#include "graph.h"
+#include "path_repair.h"
+#include "pvector.h"
+#include "shortest_path.h"
+
+
+/*
+GAP Benchmark Suite
+Kernel: Incremental Single-source Shortest Paths (SSSP)
+
+Returns array of distances for all vertices from given source vertex, repaired
+from the distances they had before a batch of edge updates
+
+Before the trials, a batch of random edge updates (-b updates, -p percent of
+them deletions) is generated for the input graph (UpdateGenerator) and applied
+to a DynamicGraph of the input graph, whose update rate is reported. The old
+graph is searched from the source with DeltaStep (delta from EstimateDelta),
+and its shortest-path tree is recovered from the distances
+(ParentsFromDistances). Each trial repairs a copy of those distances and that
+tree on the DynamicGraph with RepairPaths (path_repair.h) rather than searching
+it again, and is checked by the SSSP verifier on the updated graph made
+independently by Builder::ApplyUpdates, so it must match a fresh search.
+*/
+
+
+using namespace std;
+
+
+int main(int argc, char* argv[]) {
+  CLUpdate cli(argc, argv, "incremental single-source shortest-path");
+  if (!cli.ParseArgs())
+    return -1;
+  WeightedBuilder b(cli);
+  WGraph g_old = b.MakeGraph();
+  UpdateGenerator<NodeID, WNode, WeightT> updates(g_old, cli.batch_size(),
+                                                  cli.delete_percent());
+  UpdateBatch<NodeID, WNode> batch = updates.NextBatch();
+  WGraph g = WeightedBuilder::ApplyUpdates(g_old, batch.insertions,
+                                           batch.deletions);
+  DynamicGraph<NodeID, WNode> dg(g_old);
+  dg.ApplyBatch(batch.insertions, batch.deletions);
+  WeightedBuilder::SortByWeight(g_old);
+  SourcePicker<WGraph> sp(g_old, cli.start_vertex());
+  NodeID source = sp.PickNext();
+  BinPool<NodeID> bin_pool;
+  WeightT delta = EstimateDelta(g_old);
+  pvector<WeightT> old_dist = DeltaStep(g_old, source, delta,
+                                        CountLightEdges(g_old, delta),
+                                        bin_pool);
+  pvector<NodeID> old_parent = ParentsFromDistances(g_old, source, old_dist);
+  typedef DynamicGraph<NodeID, WNode> DWGraph;
+  auto RepairBound = [&batch, &old_dist, &old_parent] (const DWGraph &dg) {
+    pvector<WeightT> dist(old_dist.begin(), old_dist.end());
+    pvector<NodeID> parent(old_parent.begin(), old_parent.end());
+    RepairPaths(dg, batch, dist, parent);
+    return dist;
+  };
+  auto StatsBound = [&g] (const DWGraph &, const pvector<WeightT> &dist) {
+    PrintSSSPStats(g, dist);
+  };
+  auto VerifierBound = [&g, source] (const DWGraph &,
+                                     const pvector<WeightT> &dist) {
+    return SSSPVerifier(g, source, dist);
+  };
+  BenchmarkKernel(cli, dg, RepairBound, StatsBound, VerifierBound);
+  return 0;
+}
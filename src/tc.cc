@@ -3,6 +3,8 @@
 
 #include <algorithm>
 #include <cinttypes>
+#include <cmath>
+#include <cstddef>
 #include <iostream>
 #include <vector>
 
@@ -10,7 +12,9 @@
 #include "builder.h"
 #include "command_line.h"
 #include "graph.h"
+#include "platform_atomics.h"
 #include "pvector.h"
+#include "set_intersection.h"
 
 
 /*
@@ -35,31 +39,80 @@ a triangle only once, this implementation only counts a triangle if u > v > w.
 Once the remaining unexamined neighbors identifiers get too big, it can break
 out of the loop, but this requires that the neighbors to be sorted.
 
-Another optimization this implementation has is to relabel the vertices by
-degree. This is beneficial if the average degree is high enough and if the
-degree distribution is sufficiently non-uniform. To decide whether or not
-to relabel the graph, we use the heuristic in WorthRelabelling.
+The neighbors u and v have in common are counted by set_intersection.h, which
+merges with the widest SIMD instructions the CPU supports, or gallops through
+the longer neighborhood if the other is much shorter. If u has many neighbors
+and v has far fewer, u's neighbors are instead marked in a bitmap that is then
+probed with v's, since u is intersected with each of its neighbors in turn.
+
+Another optimization this implementation has is to orient the edges by
+degree (Builder::OrientByDegree), which relabels the vertices by decreasing
+degree and keeps only each vertex's neighbors of higher degree, so each
+triangle is counted once from its lowest ranked vertex. The oriented graph has
+half the edges of the relabelled one, and since no vertex has more than
+sqrt(2|E|) out-neighbors, hubs no longer have to be intersected with every one
+of their neighbors. This is beneficial if the average degree is high enough
+and if the degree distribution is sufficiently non-uniform. To decide whether
+or not to orient the graph, we use the heuristic in WorthOrienting.
+
+With -p, it instead estimates the count by edge sampling [1]: each edge is
+kept with probability p, and the triangles in the sampled graph (which each
+survive with probability p^3) are scaled up by 1/p^3. The variance of that
+estimate is T(1/p^3 - 1) + 2K(1/p - 1), where K is the number of pairs of
+triangles sharing an edge [1]. The sampled graph is oriented by degree and
+the triangles of each of its edges are counted, which also gives an unbiased
+estimate of K (a pair survives with probability p^5), so the estimate is
+reported with a 95% confidence interval, unless too few triangles were sampled
+for one to mean anything. Whether an edge is sampled comes from a hash of its
+endpoints with kRandSeed, so runs are repeatable for any number of threads.
+Work falls roughly with p^2, and the exact count (Hybrid) is the verifier.
+
+[1] Charalampos E. Tsourakakis, U Kang, Gary L. Miller, and Christos
+    Faloutsos. "DOULION: counting triangles in massive graphs with a coin."
+    ACM SIGKDD International Conference on Knowledge Discovery and Data
+    Mining, pages 837-846, 2009.
 */
 
 
 using namespace std;
 
+// Counts each triangle once, either in an undirected graph (as u > v > w) or
+// in a DAG from Builder::OrientByDegree (from u along its out-edges to v and
+// a common out-neighbor w)
 size_t OrderedCount(const Graph &g) {
+  // A high-degree u is intersected with a neighbor v whose part is much
+  // shorter by probing NeighborMarks of u's part (set once for u and reused
+  // for all such v). Other pairs use AdaptiveIntersectionSize, which gallops
+  // through skewed ones.
+  const bool oriented = g.directed();
   size_t total = 0;
-  #pragma omp parallel for reduction(+ : total) schedule(dynamic, 64)
-  for (NodeID u=0; u < g.num_nodes(); u++) {
-    for (NodeID v : g.out_neigh(u)) {
-      if (v > u)
-        break;
-      auto it = g.out_neigh(u).begin();
-      for (NodeID w : g.out_neigh(v)) {
-        if (w > v)
-          break;
-        while (*it < w)
-          it++;
-        if (w == *it)
-          total++;
+  #pragma omp parallel reduction(+ : total)
+  {
+    NeighborMarks marks(g.num_nodes());
+    #pragma omp for schedule(dynamic, 64)
+    for (NodeID u=0; u < g.num_nodes(); u++) {
+      auto u_neigh = g.out_neigh(u);
+      NodeID* u_part_end = oriented ? u_neigh.end() :
+                           lower_bound(u_neigh.begin(), u_neigh.end(), u);
+      for (auto v_it = u_neigh.begin(); v_it < u_part_end; v_it++) {
+        NodeID v = *v_it;
+        // common neighbors w < v, which in u's neighborhood are those before
+        // v, or all common out-neighbors if oriented
+        auto v_neigh = g.out_neigh(v);
+        NodeID* v_end = oriented ? v_neigh.end() :
+                        lower_bound(v_neigh.begin(), v_neigh.end(), v);
+        NodeID* u_end = oriented ? u_part_end : v_it;
+        if (NeighborMarks::Worthwhile(g.out_degree(u),
+                                      u_end - u_neigh.begin(),
+                                      v_end - v_neigh.begin())) {
+          marks.Mark(u_neigh.begin(), u_part_end);
+          total += marks.Count(v_neigh.begin(), v_end);
+        } else {
+          total += AdaptiveIntersectionSize(u_neigh.begin(), u_end,
+                                            v_neigh.begin(), v_end);
+        }
       }
+      marks.Clear();
     }
   }
   return total;
@@ -67,7 +120,7 @@ size_t OrderedCount(const Graph &g) {
 
 
 // heuristic to see if sufficently dense power-law graph
-bool WorthRelabelling(const Graph &g) {
+bool WorthOrienting(const Graph &g) {
   int64_t average_degree = g.num_edges() / g.num_nodes();
   if (average_degree < 10)
     return false;
@@ -86,10 +139,10 @@ bool WorthRelabelling(const Graph &g) {
 }
 
 
-// uses heuristic to see if worth relabeling
+// uses heuristic to see if worth orienting by degree
 size_t Hybrid(const Graph &g) {
-  if (WorthRelabelling(g))
-    return OrderedCount(Builder::RelabelByDegree(g));
+  if (WorthOrienting(g))
+    return OrderedCount(Builder::OrientByDegree(g));
   else
     return OrderedCount(g);
 }
@@ -100,20 +153,14 @@ void PrintTriangleStats(const Graph &g, size_t total_triangles) {
 }
 
 
-// Compares with simple serial implementation that uses std::set_intersection
+// Compares with simple serial implementation that intersects the whole
+// neighborhoods of every edge
 bool TCVerifier(const Graph &g, size_t test_total) {
   size_t total = 0;
-  vector<NodeID> intersection;
-  intersection.reserve(g.num_nodes());
   for (NodeID u : g.vertices()) {
     for (NodeID v : g.out_neigh(u)) {
-      auto new_end = set_intersection(g.out_neigh(u).begin(),
-                                      g.out_neigh(u).end(),
-                                      g.out_neigh(v).begin(),
-                                      g.out_neigh(v).end(),
-                                      intersection.begin());
-      intersection.resize(new_end - intersection.begin());
-      total += intersection.size();
+      total += IntersectionSize(g.out_neigh(u).begin(), g.out_neigh(u).end(),
+                                g.out_neigh(v).begin(), g.out_neigh(v).end());
     }
   }
   total = total / 6;  // each triangle was counted 6 times
@@ -123,16 +170,174 @@ bool TCVerifier(const Graph &g, size_t test_total) {
 }
 
 
+// Pseudorandom number in [0, 1) for edge (u, v), the same for (v, u), from
+// hashing its endpoints (SeededHash)
+inline
+double EdgeCoin(NodeID u, NodeID v) {
+  uint64_t x = SeededHash((static_cast<uint64_t>(min(u, v)) << 32) |
+                          static_cast<uint32_t>(max(u, v)));
+  return (x >> 11) * (1.0 / (static_cast<uint64_t>(1) << 53));
+}
+
+
+// Copy of g that keeps each edge with probability p, where both directions of
+// an edge (and any number of threads) agree since the coin is a hash
+Graph SampleEdges(const Graph &g, double p) {
+  pvector<NodeID> degrees(g.num_nodes());
+  #pragma omp parallel for schedule(dynamic, 64)
+  for (NodeID u=0; u < g.num_nodes(); u++) {
+    degrees[u] = 0;
+    for (NodeID v : g.out_neigh(u))
+      degrees[u] += EdgeCoin(u, v) < p;
+  }
+  pvector<SGOffset> offsets = Builder::ParallelPrefixSum(degrees);
+  NodeID *neighs = new NodeID[offsets[g.num_nodes()]];
+  NodeID **index = Graph::GenIndex(offsets, neighs);
+  #pragma omp parallel for schedule(dynamic, 64)
+  for (NodeID u=0; u < g.num_nodes(); u++) {
+    for (NodeID v : g.out_neigh(u)) {
+      if (EdgeCoin(u, v) < p)
+        neighs[offsets[u]++] = v;
+    }
+  }
+  return Graph(g.num_nodes(), index, neighs);
+}
+
+
+struct TriangleEstimate {
+  double count;
+  double std_dev;
+  int64_t sampled;  // triangles left in the sampled graph
+  double sample_rate;
+};
+
+
+// Estimates triangles from the ones left after sampling edges with
+// probability p (described above)
+TriangleEstimate EstimateTriangles(const Graph &g, double p) {
+  Graph dag = Builder::OrientByDegree(SampleEdges(g, p));
+  // Triangles each sampled edge is in, found once each from their lowest
+  // ranked vertex u by probing u's out-neighbors (marked with their index)
+  // with those of each of them
+  pvector<NodeID> edge_triangles(dag.num_edges(), 0);
+  const NodeID *base = dag.out_neigh(0).begin();
+  #pragma omp parallel
+  {
+    vector<NodeID> slot(dag.num_nodes(), -1);
+    #pragma omp for schedule(dynamic, 64)
+    for (NodeID u=0; u < dag.num_nodes(); u++) {
+      NodeID *u_neigh = dag.out_neigh(u).begin();
+      for (NodeID i=0; i < dag.out_degree(u); i++)
+        slot[u_neigh[i]] = i;
+      for (NodeID *v_it = u_neigh; v_it < dag.out_neigh(u).end(); v_it++) {
+        for (NodeID *w_it = dag.out_neigh(*v_it).begin();
+             w_it < dag.out_neigh(*v_it).end(); w_it++) {
+          if (slot[*w_it] != -1) {
+            fetch_and_add(edge_triangles[v_it - base], 1);
+            fetch_and_add(edge_triangles[u_neigh + slot[*w_it] - base], 1);
+            fetch_and_add(edge_triangles[w_it - base], 1);
+          }
+        }
+      }
+      for (NodeID i=0; i < dag.out_degree(u); i++)
+        slot[u_neigh[i]] = -1;
+    }
+  }
+  int64_t total = 0;
+  int64_t shared_pairs = 0;
+  #pragma omp parallel for reduction(+ : total, shared_pairs)
+  for (int64_t e=0; e < dag.num_edges(); e++) {
+    int64_t common = edge_triangles[e];
+    total += common;
+    shared_pairs += common * (common - 1) / 2;
+  }
+  double p3 = p * p * p;
+  TriangleEstimate estimate;
+  estimate.sampled = total / 3;
+  estimate.sample_rate = p;
+  estimate.count = estimate.sampled / p3;
+  double pairs = shared_pairs / (p3 * p * p);
+  double variance = estimate.count * (1 / p3 - 1) + 2 * pairs * (1 / p - 1);
+  estimate.std_dev = sqrt(variance);
+  return estimate;
+}
+
+
+// Two-sided 95% confidence interval
+const double kConfidenceZ = 1.96;
+
+// With fewer sampled triangles than this, the variance estimate (which is 0
+// when none are sampled) is too rough for a normal confidence interval
+const int64_t kMinSampled = 10;
+
+
+void PrintEstimateStats(const Graph &g, const TriangleEstimate &estimate) {
+  cout << "~" << static_cast<int64_t>(round(estimate.count)) << " triangles";
+  if (estimate.sampled < kMinSampled) {
+    cout << " (only " << estimate.sampled << " sampled, too few for a CI,"
+         << " so raise -p)" << endl;
+    return;
+  }
+  double half_width = kConfidenceZ * estimate.std_dev;
+  cout << " (95% CI: "
+       << static_cast<int64_t>(max(0.0, estimate.count - half_width))
+       << " - " << static_cast<int64_t>(ceil(estimate.count + half_width))
+       << ")" << endl;
+}
+
+
+// Compares with the exact count (Hybrid), which passes if within
+// kMaxDeviations standard deviations of the estimate. If too few triangles
+// were sampled for that, it instead passes if the exact count would sample
+// fewer than twice kMinSampled in expectation, since otherwise a sample that
+// small is unlikely (under 1% if the number sampled were Poisson).
+bool EstimateVerifier(const Graph &g, const TriangleEstimate &estimate) {
+  const double kMaxDeviations = 3;
+  size_t exact = Hybrid(g);
+  if (estimate.sampled < kMinSampled) {
+    double p = estimate.sample_rate;
+    double expected_sampled = exact * p * p * p;
+    if (expected_sampled >= 2 * kMinSampled) {
+      cout << estimate.sampled << " triangles sampled, but " << exact
+           << " would sample " << expected_sampled << " in expectation"
+           << endl;
+      return false;
+    }
+    return true;
+  }
+  double error = fabs(estimate.count - exact);
+  if (error > kMaxDeviations * estimate.std_dev) {
+    cout << exact << " is " << error / estimate.std_dev
+         << " standard deviations from " << estimate.count << endl;
+    return false;
+  }
+  return true;
+}
+
+
 int main(int argc, char* argv[]) {
-  CLApp cli(argc, argv, "triangle count");
+  CLTC cli(argc, argv, "triangle count");
   if (!cli.ParseArgs())
     return -1;
+  if ((cli.sample_rate() <= 0) || (cli.sample_rate() > 1)) {
+    cout << "Sample rate must be in (0, 1]" << endl;
+    return -1;
+  }
   Builder b(cli);
   Graph g = b.MakeGraph();
   if (g.directed()) {
     cout << "Input graph is directed but tc requires undirected" << endl;
     return -2;
   }
-  BenchmarkKernel(cli, g, Hybrid, PrintTriangleStats, TCVerifier);
+  PrintLabel("Intersection", ActiveIntersectionKernel().name);
+  if (cli.sample_rate() == 1) {
+    BenchmarkKernel(cli, g, Hybrid, PrintTriangleStats, TCVerifier);
+  } else {
+    auto EstimateBound = [&cli] (const Graph &g) {
+      return EstimateTriangles(g, cli.sample_rate());
+    };
+    BenchmarkKernel(cli, g, EstimateBound, PrintEstimateStats,
+                    EstimateVerifier);
+  }
   return 0;
 }
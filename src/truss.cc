@@ -0,0 +1,461 @@
+// Copyright (c) 2015, The Regents of the University of California (Regents)
+// See LICENSE.txt for license details
+
+#include <algorithm>
+#include <cinttypes>
+#include <cmath>
+#include <cstddef>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <queue>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "benchmark.h"
+#include "bitmap.h"
+#include "builder.h"
+#include "command_line.h"
+#include "graph.h"
+#include "platform_atomics.h"
+#include "pvector.h"
+#include "set_intersection.h"
+#include "sliding_queue.h"
+
+
+/*
+GAP Benchmark Suite
+Kernel: Triangle Analysis (Truss)
+
+Will return the number of triangles each vertex is in, its local clustering
+coefficient (LCC), and the truss number of each edge
+
+Requires input graph:
+  - to be undirected
+  - no duplicate edges
+  - neighborhoods are sorted by vertex identifiers
+
+The support of an edge (u, v) is the number of triangles it is in, which is
+the number of neighbors u and v have in common. Each edge is stored twice in
+the CSR, and its support and truss number are kept at the position of its
+copy in the neighborhood of its lower endpoint (CanonicalEdgeIDs maps both
+positions there). Supports are counted as in tc (intersections from
+set_intersection.h, or probing a bitmap of a high-degree vertex's neighbors),
+and a vertex is in half the sum of the supports of its edges.
+
+The k-truss is the largest subgraph in which every edge has support at least
+k-2, and the truss number of an edge is the largest k for which it is in the
+k-truss. They are found by peeling [1]: edges are removed in order of their
+support, and removing an edge lowers the support of the other two edges of
+each of its remaining triangles. Edges with the lowest support (the level)
+form a bucket that is peeled in parallel rounds, where each round removes the
+bucket and the next bucket holds the edges whose support fell to the level
+during it. Supports never fall below the level, and a triangle with more than
+one edge in the bucket lowers its remaining edge only once. When the bucket
+runs out, the level rises to the lowest support left. Each edge's truss
+number is its level + 2.
+
+The results can be saved as text: -o writes "v triangles lcc" for each vertex
+and -e writes "u v k" for each edge (u < v), which loads back as a weighted
+edge list (.wel).
+
+[1] Humayun Kabir and Kamesh Madduri. "Shared-memory graph truss
+    decomposition." International Conference on High Performance Computing
+    (HiPC), 2017.
+*/
+
+
+using namespace std;
+
+
+struct TrussResult {
+  pvector<int64_t> triangles;
+  pvector<double> lcc;
+  pvector<NodeID> truss;  // by canonical edge ID (see CanonicalEdgeIDs)
+
+  explicit TrussResult(const Graph &g) : triangles(g.num_nodes()),
+      lcc(g.num_nodes()), truss(g.num_edges_directed()) {}
+};
+
+
+// Position of an edge's neighbor entry within the CSR
+inline
+SGOffset EdgePosition(const Graph &g, const NodeID *neighbor) {
+  return neighbor - g.out_neigh(0).begin();
+}
+
+
+// For each position in the CSR, the position of the same edge in the
+// neighborhood of its lower endpoint
+pvector<SGOffset> CanonicalEdgeIDs(const Graph &g) {
+  pvector<SGOffset> edge_ids(g.num_edges_directed());
+  #pragma omp parallel for schedule(dynamic, 64)
+  for (NodeID u=0; u < g.num_nodes(); u++) {
+    for (NodeID *v_it = g.out_neigh(u).begin(); v_it < g.out_neigh(u).end();
+         v_it++) {
+      NodeID v = *v_it;
+      if (u < v) {
+        edge_ids[EdgePosition(g, v_it)] = EdgePosition(g, v_it);
+      } else {
+        NodeID *u_it = lower_bound(g.out_neigh(v).begin(),
+                                   g.out_neigh(v).end(), u);
+        edge_ids[EdgePosition(g, v_it)] = EdgePosition(g, u_it);
+      }
+    }
+  }
+  return edge_ids;
+}
+
+
+// Support of each edge, by canonical edge ID
+pvector<NodeID> CountSupports(const Graph &g) {
+  pvector<NodeID> support(g.num_edges_directed());
+  #pragma omp parallel
+  {
+    NeighborMarks marks(g.num_nodes());
+    #pragma omp for schedule(dynamic, 64)
+    for (NodeID u=0; u < g.num_nodes(); u++) {
+      auto u_neigh = g.out_neigh(u);
+      for (NodeID *v_it = upper_bound(u_neigh.begin(), u_neigh.end(), u);
+           v_it < u_neigh.end(); v_it++) {
+        auto v_neigh = g.out_neigh(*v_it);
+        NodeID common;
+        if (NeighborMarks::Worthwhile(g.out_degree(u), g.out_degree(u),
+                                      g.out_degree(*v_it))) {
+          marks.Mark(u_neigh.begin(), u_neigh.end());
+          common = marks.Count(v_neigh.begin(), v_neigh.end());
+        } else {
+          common = AdaptiveIntersectionSize(u_neigh.begin(), u_neigh.end(),
+                                            v_neigh.begin(), v_neigh.end());
+        }
+        support[EdgePosition(g, v_it)] = common;
+      }
+      marks.Clear();
+    }
+  }
+  return support;
+}
+
+
+void VertexTriangles(const Graph &g, const pvector<SGOffset> &edge_ids,
+                     const pvector<NodeID> &support, TrussResult &result) {
+  #pragma omp parallel for schedule(dynamic, 64)
+  for (NodeID u=0; u < g.num_nodes(); u++) {
+    int64_t total = 0;
+    for (NodeID *v_it = g.out_neigh(u).begin(); v_it < g.out_neigh(u).end();
+         v_it++)
+      total += support[edge_ids[EdgePosition(g, v_it)]];
+    result.triangles[u] = total / 2;
+    int64_t degree = g.out_degree(u);
+    result.lcc[u] = degree < 2 ? 0 :
+                    2.0 * result.triangles[u] / (degree * (degree - 1));
+  }
+}
+
+
+// Lower endpoint of the edge with canonical ID e
+inline
+NodeID EdgeSource(const pvector<SGOffset> &offsets, SGOffset e) {
+  return upper_bound(offsets.begin(), offsets.end(), e) - offsets.begin() - 1;
+}
+
+
+// Lowers support of edge e (on behalf of a peeled edge at level), adding e to
+// the next bucket if it reaches level, but never lowering it below level
+inline
+void LowerSupport(SGOffset e, NodeID level, pvector<NodeID> &support,
+                  QueueBuffer<SGOffset> &next_bucket) {
+  NodeID old_support = fetch_and_add(support[e], -1);
+  if (old_support == level + 1)
+    next_bucket.push_back(e);
+  if (old_support <= level)
+    fetch_and_add(support[e], 1);
+}
+
+
+// Truss number of each edge by peeling (described above), uses up support.
+// Both copies of a peeled edge are marked in peeled, so triangles with a
+// peeled edge are skipped without looking up canonical IDs.
+void PeelTruss(const Graph &g, const pvector<SGOffset> &edge_ids,
+               pvector<NodeID> &support, TrussResult &result) {
+  pvector<SGOffset> offsets = g.VertexOffsets();
+  Bitmap peeled(g.num_edges_directed());
+  Bitmap in_bucket(g.num_edges_directed());
+  peeled.reset();
+  in_bucket.reset();
+  SlidingQueue<SGOffset> bucket(g.num_edges());
+  SlidingQueue<SGOffset> remaining_a(g.num_edges());
+  SlidingQueue<SGOffset> remaining_b(g.num_edges());
+  SlidingQueue<SGOffset> *remaining = &remaining_a;
+  SlidingQueue<SGOffset> *survivors = &remaining_b;
+  #pragma omp parallel
+  {
+    QueueBuffer<SGOffset> lremaining(*remaining);
+    #pragma omp for schedule(dynamic, 64) nowait
+    for (NodeID u=0; u < g.num_nodes(); u++) {
+      for (NodeID *v_it = upper_bound(g.out_neigh(u).begin(),
+                                      g.out_neigh(u).end(), u);
+           v_it < g.out_neigh(u).end(); v_it++)
+        lremaining.push_back(EdgePosition(g, v_it));
+    }
+    lremaining.flush();
+  }
+  remaining->slide_window();
+  int64_t num_rounds = 0;
+  while (!remaining->empty()) {
+    // Drop peeled edges and find the lowest support left
+    NodeID level = numeric_limits<NodeID>::max();
+    survivors->reset();
+    #pragma omp parallel reduction(min : level)
+    {
+      QueueBuffer<SGOffset> lsurvivors(*survivors);
+      #pragma omp for nowait
+      for (auto it = remaining->begin(); it < remaining->end(); it++) {
+        if (!peeled.get_bit(*it)) {
+          lsurvivors.push_back(*it);
+          level = min(level, support[*it]);
+        }
+      }
+      lsurvivors.flush();
+    }
+    survivors->slide_window();
+    swap(remaining, survivors);
+    if (remaining->empty())
+      break;
+    #pragma omp parallel
+    {
+      QueueBuffer<SGOffset> lbucket(bucket);
+      #pragma omp for nowait
+      for (auto it = remaining->begin(); it < remaining->end(); it++) {
+        if (support[*it] == level) {
+          lbucket.push_back(*it);
+          in_bucket.set_bit_atomic(*it);
+        }
+      }
+      lbucket.flush();
+    }
+    bucket.slide_window();
+    while (!bucket.empty()) {
+      num_rounds++;
+      #pragma omp parallel
+      {
+        QueueBuffer<SGOffset> lnext(bucket);
+        #pragma omp for schedule(dynamic, 64) nowait
+        for (auto it = bucket.begin(); it < bucket.end(); it++) {
+          SGOffset e = *it;
+          NodeID u = EdgeSource(offsets, e);
+          NodeID v = g.out_neigh(0).begin()[e];
+          auto Lower = [&] (const NodeID *u_w, const NodeID *v_w) {
+            if (peeled.get_bit(EdgePosition(g, u_w)) ||
+                peeled.get_bit(EdgePosition(g, v_w)))
+              return;
+            SGOffset e1 = edge_ids[EdgePosition(g, u_w)];
+            SGOffset e2 = edge_ids[EdgePosition(g, v_w)];
+            bool e1_above = support[e1] > level;
+            bool e2_above = support[e2] > level;
+            // if both others are at the level, nothing is lowered, and if
+            // one is, only the lowest ID in the bucket lowers the third
+            if (e1_above && e2_above) {
+              LowerSupport(e1, level, support, lnext);
+              LowerSupport(e2, level, support, lnext);
+            } else if (e1_above) {
+              if ((e < e2) || !in_bucket.get_bit(e2))
+                LowerSupport(e1, level, support, lnext);
+            } else if (e2_above) {
+              if ((e < e1) || !in_bucket.get_bit(e1))
+                LowerSupport(e2, level, support, lnext);
+            }
+          };
+          ForEachCommon(g.out_neigh(u).begin(), g.out_neigh(u).end(),
+                        g.out_neigh(v).begin(), g.out_neigh(v).end(), Lower);
+        }
+        lnext.flush();
+      }
+      #pragma omp parallel for
+      for (auto it = bucket.begin(); it < bucket.end(); it++) {
+        NodeID u = EdgeSource(offsets, *it);
+        NodeID v = g.out_neigh(0).begin()[*it];
+        peeled.set_bit_atomic(*it);
+        peeled.set_bit_atomic(EdgePosition(g, lower_bound(
+            g.out_neigh(v).begin(), g.out_neigh(v).end(), u)));
+        in_bucket.clear_bit_atomic(*it);
+        result.truss[*it] = level + 2;
+      }
+      bucket.slide_window();
+      #pragma omp parallel for
+      for (auto it = bucket.begin(); it < bucket.end(); it++)
+        in_bucket.set_bit_atomic(*it);
+    }
+  }
+  PrintStep("Peeling Rounds", num_rounds);
+}
+
+
+void AnalyzeTriangles(const Graph &g, TrussResult &result) {
+  pvector<SGOffset> edge_ids = CanonicalEdgeIDs(g);
+  pvector<NodeID> support = CountSupports(g);
+  VertexTriangles(g, edge_ids, support, result);
+  PeelTruss(g, edge_ids, support, result);
+}
+
+
+void PrintTrussStats(const Graph &g, const TrussResult *result) {
+  int64_t total_triangles = 0;
+  double total_lcc = 0;
+  int64_t num_counted = 0;
+  for (NodeID n : g.vertices()) {
+    total_triangles += result->triangles[n];
+    if (g.out_degree(n) >= 2) {
+      total_lcc += result->lcc[n];
+      num_counted++;
+    }
+  }
+  cout << total_triangles / 3 << " triangles" << endl;
+  if (num_counted != 0)
+    cout << "average LCC: " << total_lcc / num_counted << endl;
+  NodeID max_truss = 0;
+  int64_t num_in_max = 0;
+  for (NodeID u : g.vertices()) {
+    for (NodeID *v_it = g.out_neigh(u).begin(); v_it < g.out_neigh(u).end();
+         v_it++) {
+      if (u > *v_it)
+        continue;
+      NodeID k = result->truss[EdgePosition(g, v_it)];
+      if (k > max_truss) {
+        max_truss = k;
+        num_in_max = 0;
+      }
+      num_in_max += k == max_truss;
+    }
+  }
+  cout << "max truss: " << max_truss << " (" << num_in_max << " edges)"
+       << endl;
+}
+
+
+// Compares with serial counts from whole-neighborhood merges, and serial
+// peeling that always removes an edge of least support (from a heap)
+bool TrussVerifier(const Graph &g, const TrussResult *result) {
+  pvector<SGOffset> edge_ids = CanonicalEdgeIDs(g);
+  pvector<NodeID> support(g.num_edges_directed(), 0);
+  pvector<int64_t> triangles(g.num_nodes(), 0);
+  typedef pair<NodeID, SGOffset> support_edge_p;
+  priority_queue<support_edge_p, vector<support_edge_p>,
+                 greater<support_edge_p>> heap;
+  for (NodeID u : g.vertices()) {
+    for (NodeID *v_it = g.out_neigh(u).begin(); v_it < g.out_neigh(u).end();
+         v_it++) {
+      NodeID v = *v_it;
+      NodeID common = 0;
+      ForEachCommon(g.out_neigh(u).begin(), g.out_neigh(u).end(),
+                    g.out_neigh(v).begin(), g.out_neigh(v).end(),
+                    [&common] (const NodeID *, const NodeID *) { common++; });
+      triangles[u] += common;
+      if (u < v) {
+        support[EdgePosition(g, v_it)] = common;
+        heap.push(make_pair(common, EdgePosition(g, v_it)));
+      }
+    }
+  }
+  bool all_ok = true;
+  for (NodeID n : g.vertices()) {
+    triangles[n] /= 2;
+    int64_t degree = g.out_degree(n);
+    double lcc = degree < 2 ? 0 : 2.0 * triangles[n] / (degree * (degree - 1));
+    if ((triangles[n] != result->triangles[n]) ||
+        (fabs(lcc - result->lcc[n]) > 1e-9)) {
+      cout << n << ": " << result->triangles[n] << " triangles (LCC "
+           << result->lcc[n] << ") != " << triangles[n] << " (LCC " << lcc
+           << ")" << endl;
+      all_ok = false;
+    }
+  }
+  pvector<SGOffset> offsets = g.VertexOffsets();
+  vector<bool> removed(g.num_edges_directed(), false);
+  NodeID level = 0;
+  while (!heap.empty()) {
+    SGOffset e = heap.top().second;
+    NodeID e_support = heap.top().first;
+    heap.pop();
+    if (removed[e] || (e_support != support[e]))
+      continue;
+    level = max(level, e_support);
+    NodeID u = EdgeSource(offsets, e);
+    NodeID v = g.out_neigh(0).begin()[e];
+    if (result->truss[e] != level + 2) {
+      cout << u << " " << v << ": " << result->truss[e] << " != "
+           << level + 2 << endl;
+      all_ok = false;
+    }
+    removed[e] = true;
+    ForEachCommon(g.out_neigh(u).begin(), g.out_neigh(u).end(),
+                  g.out_neigh(v).begin(), g.out_neigh(v).end(),
+                  [&] (const NodeID *u_w, const NodeID *v_w) {
+      SGOffset e1 = edge_ids[EdgePosition(g, u_w)];
+      SGOffset e2 = edge_ids[EdgePosition(g, v_w)];
+      if (removed[e1] || removed[e2])
+        return;
+      heap.push(make_pair(--support[e1], e1));
+      heap.push(make_pair(--support[e2], e2));
+    });
+  }
+  return all_ok;
+}
+
+
+// Writes "v triangles lcc" for each vertex
+void WriteVertexStats(const TrussResult &result, string filename) {
+  ofstream out(filename);
+  if (!out) {
+    cout << "Couldn't write to file " << filename << endl;
+    exit(-5);
+  }
+  for (size_t n=0; n < result.triangles.size(); n++)
+    out << n << " " << result.triangles[n] << " " << result.lcc[n] << "\n";
+}
+
+
+// Writes "u v k" for each edge (u < v), a .wel weighted by truss number
+void WriteEdgeTruss(const Graph &g, const TrussResult &result,
+                    string filename) {
+  ofstream out(filename);
+  if (!out) {
+    cout << "Couldn't write to file " << filename << endl;
+    exit(-5);
+  }
+  for (NodeID u : g.vertices()) {
+    for (NodeID *v_it = g.out_neigh(u).begin(); v_it < g.out_neigh(u).end();
+         v_it++) {
+      if (u < *v_it)
+        out << u << " " << *v_it << " "
+            << result.truss[EdgePosition(g, v_it)] << "\n";
+    }
+  }
+}
+
+
+int main(int argc, char* argv[]) {
+  CLTruss cli(argc, argv, "triangle analysis");
+  if (!cli.ParseArgs())
+    return -1;
+  Builder b(cli);
+  Graph g = b.MakeGraph();
+  if (g.directed()) {
+    cout << "Input graph is directed but truss requires undirected" << endl;
+    return -2;
+  }
+  // filled in place by each trial, so the last one can be saved
+  TrussResult result(g);
+  auto AnalyzeBound = [&result] (const Graph &g) {
+    AnalyzeTriangles(g, result);
+    return &result;
+  };
+  BenchmarkKernel(cli, g, AnalyzeBound, PrintTrussStats, TrussVerifier);
+  if (cli.vertex_out() != "")
+    WriteVertexStats(result, cli.vertex_out());
+  if (cli.edge_out() != "")
+    WriteEdgeTruss(g, result, cli.edge_out());
+  return 0;
+}
@@ -8,6 +8,10 @@
 #include <cinttypes>
 #include <string>
 
+#if defined _OPENMP
+  #include <omp.h>
+#endif
+
 #include "timer.h"
 
 
@@ -48,6 +52,34 @@ void PrintStep(const std::string &s, double seconds, int64_t count = -1) {
     printf("%5s%23.5lf\n", s.c_str(), seconds);
 }
 
+// Index of calling thread within its parallel region (0 when serial)
+int ThreadNum() {
+#if defined _OPENMP
+  return omp_get_thread_num();
+#else
+  return 0;
+#endif
+}
+
+// Upper bound on number of threads a parallel region will use
+int MaxThreads() {
+#if defined _OPENMP
+  return omp_get_max_threads();
+#else
+  return 1;
+#endif
+}
+
+// Pseudorandom bits for x mixed with kRandSeed (splitmix64 finalizer), so any
+// thread can draw the same value for the same x without shared state
+inline
+uint64_t SeededHash(uint64_t x) {
+  x += kRandSeed * 0x9E3779B97F4A7C15ULL;
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+  return x ^ (x >> 31);
+}
+
 // Runs op and prints the time it took to execute labelled by label
 #define TIME_PRINT(label, op) {   \
   Timer t_;                       \
@@ -84,3 +84,29 @@ test-verify-%-$(TEST_GRAPH): test/out/verify-%-$(TEST_GRAPH).out
 	fi
 
 test-verify: $(addsuffix -$(TEST_GRAPH), $(addprefix test-verify-, $(KERNELS)))
+
+# Kernel modes selected by flags, tested as <kernel>-<mode>
+VERIFY_MODES = sssp-auto sssp-probe sssp-mq tc-p community-lp color-jp \
+               cc-stream
+MODE_FLAGS_sssp-auto = -d auto
+MODE_FLAGS_sssp-probe = -d probe
+MODE_FLAGS_sssp-mq = -m
+MODE_FLAGS_tc-p = -p 0.5
+MODE_FLAGS_community-lp = -l
+MODE_FLAGS_color-jp = -j
+MODE_FLAGS_cc-stream = -e
+
+mode-kernel = $(firstword $(subst -, ,$(1)))
+
+.SECONDEXPANSION:
+test/out/verify-mode-%-$(TEST_GRAPH).out: test/out $$(call mode-kernel,$$*)
+	./$(call mode-kernel,$*) -$(TEST_GRAPH) -vn1 $(MODE_FLAGS_$*) > $@
+
+test-verify-mode-%-$(TEST_GRAPH): test/out/verify-mode-%-$(TEST_GRAPH).out
+	@if grep -q "Verification:           PASS" $<; \
+		then echo " $(PASS) Verify $* ($(MODE_FLAGS_$*))"; \
+		else echo " $(FAIL) Verify $* ($(MODE_FLAGS_$*))"; \
+	fi
+
+test-verify: $(addsuffix -$(TEST_GRAPH), \
+                         $(addprefix test-verify-mode-, $(VERIFY_MODES)))